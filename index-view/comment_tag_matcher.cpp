@@ -0,0 +1,170 @@
+/*   This file is part of KatePlugin-IndexView
+ *
+ *   CommentTagMatcher Class
+ *   Copyright (C) 2025 loh.tar@googlemail.com
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Library General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Library General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include <QQueue>
+
+#include "comment_tag_matcher.h"
+
+
+/**
+ * The same chars as @c \\w of QRegularExpression, which does not use Unicode properties
+ */
+static bool isWordChar(const QChar c)
+{
+    const char16_t u = c.unicode();
+    return (u >= u'a' && u <= u'z') || (u >= u'A' && u <= u'Z') || (u >= u'0' && u <= u'9') || u == u'_';
+}
+
+
+/**
+ * @return true when there is a @c \\b at @p pos of @p text
+ */
+static bool isWordBoundary(QStringView text, const qsizetype pos)
+{
+    const bool wordInFront = pos > 0 && isWordChar(text.at(pos - 1));
+    const bool wordBehind = pos < text.size() && isWordChar(text.at(pos));
+
+    return wordInFront != wordBehind;
+}
+
+
+CommentTagMatcher::CommentTagMatcher()
+{
+    p_states.append(State());
+}
+
+
+CommentTagMatcher::~CommentTagMatcher()
+{
+}
+
+
+void CommentTagMatcher::addTag(const QString &tag, const int nodeType)
+{
+    if (tag.isEmpty() || p_tags.contains(tag)) {
+        return;
+    }
+
+    const int index = p_tags.size();
+    const int sameType = p_nodeTypes.indexOf(nodeType);
+    p_tags.append(tag);
+    p_nodeTypes.append(nodeType);
+    p_ranks.append(sameType < 0 ? index : p_ranks.at(sameType));
+
+    int state = 0;
+    for (const QChar c : tag) {
+        int next = nextState(state, c.unicode());
+        if (next < 0) {
+            next = p_states.size();
+            p_states.append(State());
+            p_transitions.insert(quint64(state) << 16 | c.unicode(), next);
+        }
+        state = next;
+    }
+    p_states[state].tags.append(index);
+
+    // Tags are only added once at setup, so it's fine to do it each time again
+    buildFailLinks();
+}
+
+
+void CommentTagMatcher::buildFailLinks()
+{
+    // All children of a state, each transition is only once in the hash
+    QHash<int, QList<QPair<char16_t, int>>> children;
+    for (auto it = p_transitions.constBegin(); it != p_transitions.constEnd(); ++it) {
+        children[int(it.key() >> 16)].append(qMakePair(char16_t(it.key() & 0xffff), it.value()));
+    }
+
+    for (State &state : p_states) {
+        state.fail = 0;
+    }
+
+    // Breadth first, so the fail state is always done in front of its users
+    QQueue<int> queue;
+    queue.enqueue(0);
+    while (!queue.isEmpty()) {
+        const int state = queue.dequeue();
+        for (const auto &child : children.value(state)) {
+            if (state > 0) {
+                int fail = p_states.at(state).fail;
+                while (fail > 0 && nextState(fail, child.first) < 0) {
+                    fail = p_states.at(fail).fail;
+                }
+                const int next = nextState(fail, child.first);
+                p_states[child.second].fail = next < 0 ? 0 : next;
+
+                // The own tags are added first, each only once
+                for (const int tag : p_states.at(p_states.at(child.second).fail).tags) {
+                    if (!p_states.at(child.second).tags.contains(tag)) {
+                        p_states[child.second].tags.append(tag);
+                    }
+                }
+            }
+            queue.enqueue(child.second);
+        }
+    }
+}
+
+
+CommentTagMatcher::Match CommentTagMatcher::match(QStringView text) const
+{
+    Match best;
+    int bestRank = p_tags.size();
+
+    int state = 0;
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        const char16_t c = text.at(i).unicode();
+        int next = nextState(state, c);
+        while (next < 0 && state > 0) {
+            state = p_states.at(state).fail;
+            next = nextState(state, c);
+        }
+        state = next < 0 ? 0 : next;
+
+        for (const int tag : p_states.at(state).tags) {
+            const QString &tagText = p_tags.at(tag);
+            const qsizetype length = tagText.size();
+            const qsizetype start = i + 1 - length;
+            if (p_ranks.at(tag) > bestRank) {
+                continue;
+            }
+            // A tag like @todo or XXX: has its own border on the side of the non word char
+            if (isWordChar(tagText.front()) && !isWordBoundary(text, start)) {
+                continue;
+            }
+            if (isWordChar(tagText.back()) && !isWordBoundary(text, i + 1)) {
+                continue;
+            }
+            // Of equal ranks wins the last one, the text in front of it is then the longest
+            if (p_ranks.at(tag) < bestRank || start > best.start) {
+                bestRank = p_ranks.at(tag);
+                best.nodeType = p_nodeTypes.at(tag);
+                best.start = start;
+                best.length = length;
+            }
+        }
+    }
+
+    return best;
+}
+
+// kate: space-indent on; indent-width 4; replace-tabs on;
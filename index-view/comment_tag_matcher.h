@@ -0,0 +1,96 @@
+/*   This file is part of KatePlugin-IndexView
+ *
+ *   CommentTagMatcher Class
+ *   Copyright (C) 2025 loh.tar@googlemail.com
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Library General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Library General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef INDEXVIEW_COMMENTTAGMATCHER_CLASS_H
+#define INDEXVIEW_COMMENTTAGMATCHER_CLASS_H
+
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include <QStringView>
+
+/**
+ * The @c CommentTagMatcher search a text for all its tags like FIXME, TODO or BEGIN
+ * at once. The tags are hold as Aho-Corasick automaton, so each char of the text is
+ * only once looked at, no matter how many tags there are.
+ *
+ * A tag is only found as whole word, as the regex @c \\bTAG\\b would do. But a tag
+ * which begins or ends with a non word char, like @c @todo or @c XXX:, needs no
+ * word boundary on that side.
+ *
+ * @author loh.tar
+ */
+class CommentTagMatcher
+{
+
+public:
+    struct Match
+    {
+        int         nodeType = -1;  // Of the found tag or -1 when nothing was found
+        qsizetype   start = -1;
+        qsizetype   length = 0;
+    };
+
+    CommentTagMatcher();
+   ~CommentTagMatcher();
+
+    /**
+     * Add @p tag to the searched ones. A tag added earlier win when there is more
+     * than one in the text, but tags with the same @p nodeType are treated equal.
+     */
+    void addTag(const QString &tag, const int nodeType);
+
+    /**
+     * @return the tags in order of addTag()
+     */
+    QStringList tags() const { return p_tags; };
+
+    /**
+     * Search the tag of @p text which win, when there are more than one of the same
+     * node type, the last one of them.
+     */
+    Match match(QStringView text) const;
+
+private:
+    /**
+     * Build the fail links and merge the outputs of each state with the state they
+     * link to, so that match() has not to follow them
+     */
+    void buildFailLinks();
+
+    int nextState(int state, const char16_t c) const { return p_transitions.value(quint64(state) << 16 | c, -1); };
+
+    struct State
+    {
+        int         fail = 0;
+        QList<int>  tags;   // Which end here, as index of p_tags
+    };
+
+    QStringList                 p_tags;
+    QList<int>                  p_nodeTypes;    // Of each tag
+    QList<int>                  p_ranks;        // Of each tag, the lower the better
+    QList<State>                p_states;       // The first one is the root
+    QHash<quint64, int>         p_transitions;  // By state and char
+};
+
+#endif
+
+// kate: space-indent on; indent-width 4; replace-tabs on;
@@ -50,6 +50,9 @@ CppParser::CppParser(QObject *view, KTextEditor::Document *doc)
 
     m_nonBlockElements << MacroNode << FunctionDecNode;
 
+    // Preprocessor directives are treated as comment, see stripLine()
+    useLexer(DoubleQuotedStrings | SingleQuotedStrings | SlashStarComments | DoubleSlashComments | SharpComments);
+
     m_keywordsToIgnore // To avaoid false detection, e.g. as function
     << QStringLiteral("Q_FOREACH")
     << QStringLiteral("catch")
@@ -69,11 +72,19 @@ CppParser::~CppParser()
 }
 
 
+void CppParser::prepareForParse()
+{
+    ProgramParser::prepareForParse();
+
+    // AccessSpecNode need special treatment
+    m_showAccessSpec->setEnabled(showAsTree());
+}
+
+
 void CppParser::parseDocument()
 {
     // AccessSpecNode need special treatment
     nodeTypeIsWanted(AccessSpecNode);
-    m_showAccessSpec->setEnabled(showAsTree());
 
     // https://en.cppreference.com/w/cpp/language/name.html
     static const QLatin1StringView rxName(R"([a-zA-Z_]\w*)");
@@ -117,6 +128,16 @@ void CppParser::parseDocument()
     static const QLatin1StringView rx5(R"(^(?!%1)%2(%3)(\[\d+\])?([=\{\(].*)?;)");
     static const QRegularExpression rxVariableDec(rx5.arg(noneTypesToIgnore).arg(rxDeclarator).arg(rxName));
 
+    // Compile them all at once instead at the first use in the middle of a parsing run
+    static const bool optimized = [] {
+        for (const QRegularExpression *rx : { &rxStruct, &rxEnum, &rxFuncDef, &rxFuncDec, &rxTypedef, &rxNamespace,
+                                              &rxAccessSpec, &typeDefStruct, &typeDefStructA, &rxVariableDec }) {
+            rx->optimize();
+        }
+        return true;
+    }();
+    Q_UNUSED(optimized)
+
     QRegularExpressionMatch rxMatch;
 
     while (nextInstruction()) {
@@ -125,32 +146,42 @@ void CppParser::parseDocument()
         const QString firstWord = firstWordRx.match(m_line).captured(1);
 
         // Add the "default" access specifiers of a probaly just added struct in advance
-        if (lastNode() && lastNode()->type() == StructNode) {
-            if (lastNode()->text(0) == QStringLiteral("struct")) {
+        if (lastNode() != NoNode && nodeTypeOf(lastNode()) == StructNode) {
+            if (nodeText(lastNode()) == QStringLiteral("struct")) {
                     addAccessSpecNode(QStringLiteral("public"));
-            } else if (lastNode()->text(0) == QStringLiteral("class")) {
+            } else if (nodeText(lastNode()) == QStringLiteral("class")) {
                     addAccessSpecNode(QStringLiteral("private"));
             } else /*if (rxMatch.captured(1) == QStringLiteral("union"))*/ {
                     addAccessSpecNode(QStringLiteral("public"));
             }
         }
 
+        // Most lines can't match most of the regex below, so we test in advance what
+        // each of them needs at least. The order of the tests must not change
+        const bool hasParenthesis = m_line.contains(QLatin1Char('('));
+        const bool hasOpenBrace = m_line.contains(QLatin1Char('{'));
+        const bool hasSemicolon = m_line.contains(QLatin1Char(';'));
+        const bool hasTypedef = m_line.contains(QLatin1StringView("typedef"));
+        const bool isDeclarationScope = parentNodeType() == AccessSpecNode || parentNodeType() == StructNode || parentNodeType() == NamespaceNode;
+        const bool isAccessSpec = firstWord == QLatin1StringView("private") || firstWord == QLatin1StringView("protected") || firstWord == QLatin1StringView("public");
+        const bool isStruct = firstWord == QLatin1StringView("class") || firstWord == QLatin1StringView("struct") || firstWord == QLatin1StringView("union");
+
         if (m_keywordsToIgnore.contains(firstWord)) {
             // Do nothing
 
-        } else if (m_line.contains(rxNamespace, &rxMatch)) {
+        } else if (firstWord == QLatin1StringView("namespace") && m_line.contains(rxNamespace, &rxMatch)) {
             addScopeNode(NamespaceNode, rxMatch.captured(1), m_lineNumber);
 
-        } else if (m_line.contains(rxAccessSpec, &rxMatch)) {
+        } else if (isAccessSpec && m_line.contains(rxAccessSpec, &rxMatch)) {
             addAccessSpecNode(rxMatch.captured(1));
 
-        } else if (m_line.contains(rxStruct, &rxMatch)) {
+        } else if (isStruct && m_line.contains(rxStruct, &rxMatch)) {
             addScopeNode(StructNode, rxMatch.captured(3), m_lineNumber);
 
-        } else if (m_line.contains(rxEnum, &rxMatch)) {
+        } else if (hasOpenBrace && m_line.contains(QLatin1StringView("enum")) && m_line.contains(rxEnum, &rxMatch)) {
             addNode(EnumNode, rxMatch.captured(3), m_lineNumber);
 
-        } else if (m_line.contains(rxFuncDef, &rxMatch)) {
+        } else if (hasParenthesis && hasOpenBrace && m_line.contains(rxFuncDef, &rxMatch)) {
             addFuncDefNode(rxMatch.captured(1), rxMatch.captured(2), rxMatch.captured(3));
 
             // https://en.cppreference.com/w/cpp/language/function
@@ -159,12 +190,12 @@ void CppParser::parseDocument()
             // like: SomeClass foo(bar, baz);
             // so I add these parentNodeType check to have functions in header files but no stupid
             // stuff elsewhere. Edit: Also below namespace
-        } else if ((parentNodeType() == AccessSpecNode || parentNodeType() == StructNode || parentNodeType() == NamespaceNode) && m_line.contains(rxFuncDec, &rxMatch)) {
+        } else if (isDeclarationScope && hasParenthesis && hasSemicolon && m_line.contains(rxFuncDec, &rxMatch)) {
         // } else if ((parentNodeType() == StructNode || parentNodeType() == NamespaceNode) && m_line.contains(rxFuncDec, &rxMatch)) {
         // } else if ((parentNodeType() == StructNode) && m_line.contains(rxFuncDec)) {
             addNode(FunctionDecNode, rxMatch.captured(2), m_lineNumber);
 
-        } else if (m_line.contains(typeDefStruct)) {
+        } else if (hasTypedef && hasOpenBrace && m_line.contains(typeDefStruct)) {
                 // We must fast forward to grep from the end of this instruction
                 int lineNumber = m_lineNumber;
                 while ((checkForBlocks() != 0) || !m_line.endsWith(QLatin1Char(';'))) {
@@ -178,14 +209,14 @@ void CppParser::parseDocument()
                 m_line = m_line.section(QLatin1Char('}'), -1, -1);
                 m_line.chop(1);
                 addNode(TypedefNode, m_line, lineNumber);
-                lastNode()->setData(0, NodeData::EndLine, m_lineNumber);
+                setNodeEndLine(lastNode(), m_lineNumber);
 
-        } else if (m_line.contains(typeDefStructA, &rxMatch)) {
+        } else if (hasTypedef && m_line.contains(typeDefStructA, &rxMatch)) {
             // FIXME Urgs... Any idea to get rid of this extra special handling?
             // typedef struct tnode tnode; // tnode in ordinary name space is an alias to tnode in tag name space
             addNode(TypedefNode, rxMatch.captured(2), m_lineNumber);
 
-        } else if (m_line.contains(rxTypedef, &rxMatch)) {
+        } else if (hasTypedef && hasSemicolon && m_line.contains(rxTypedef, &rxMatch)) {
             static const QRegularExpression rxAlias(QStringLiteral(R"(([a-zA-Z_][\w]*))"));
             // Assume such case from cppreference.com
             //   typedef char char_t, *char_p, (*fp)(void);
@@ -195,7 +226,7 @@ void CppParser::parseDocument()
                 addNode(TypedefNode, match.captured(1), m_lineNumber);
             }
 
-        } else if ((parentNodeType() == AccessSpecNode || parentNodeType() == NamespaceNode) && m_line.contains(rxVariableDec, &rxMatch)) {
+        } else if ((parentNodeType() == AccessSpecNode || parentNodeType() == NamespaceNode) && hasSemicolon && m_line.contains(rxVariableDec, &rxMatch)) {
             // qDebug() << lineNumber() << rxMatch.captured(1) << rxMatch.captured(2) << rxMatch.captured(3) << rxMatch.captured(4);
             addNode(VariableNode, rxMatch.captured(2), m_lineNumber);
 
@@ -205,20 +236,17 @@ void CppParser::parseDocument()
     }
 
     // Because our eagerly added "default" access specifiers may unused, we remove these now
-    for (int i = 0; i < indexList()->size(); ++i) {
-        QTreeWidgetItem *item = indexList()->at(i);
-        if (item->type() != AccessSpecNode) {
+    for (int i = 0; i < nodeCount(); ++i) {
+        if (!nodeIsListed(i) || nodeTypeOf(i) != AccessSpecNode) {
             continue;
-        } else if (item->childCount() > 0) {
+        } else if (childCount(i) > 0) {
             continue;
-        } else if (!item->parent()) {
+        } else if (nodeParent(i) == NoNode) {
             // Oops?! Should never happens that we have a top level item of such type, but anyway
             continue;
         }
 
-        item->parent()->takeChild(0);
-        indexList()->takeAt(i);
-        delete item;
+        removeNode(i);
     }
 }
 
@@ -226,19 +254,19 @@ void CppParser::parseDocument()
 void CppParser::addAccessSpecNode(const QString &accessSpec)
 {
     // AccessSpecNode need special treatment
-    if (!m_showAccessSpec->isChecked() || !m_showAccessSpec->isEnabled()) {
+    if (!optionIsChecked(m_showAccessSpec) || !parseAsTree()) {
         return;
     }
 
-    QTreeWidgetItem *node = lastNode();
-    while (node) {
-        if (node->type() == StructNode) {
+    int node = lastNode();
+    while (node != NoNode) {
+        if (nodeTypeOf(node) == StructNode) {
             break;
         }
-        node = node->parent();
+        node = nodeParent(node);
     }
 
-    if (!node) {
+    if (node == NoNode) {
         // Bad syntax in document
         return;
     }
@@ -299,24 +327,20 @@ bool CppParser::appendNextLine()
 }
 
 
-void CppParser::removeStrings()
+void CppParser::stripLine()
 {
-    removeSingleQuotedStrings();
-    removeDoubleQuotedStrings();
-}
+    ProgramParser::stripLine();
 
+    // The lexer has dropped all preprocessor directives, but macros are of interest
+    if (!m_niceLine.startsWith(QLatin1Char('#'))) {
+        return;
+    }
 
-void CppParser::removeComment()
-{
-    removeMultiLineSlashStarComment();
     static const QRegularExpression rxMarcro = QRegularExpression(QStringLiteral(R"(^#define (\w+))"));
     QRegularExpressionMatch rxMatch;
-    if (m_line.contains(rxMarcro, &rxMatch)) {
+    if (m_niceLine.contains(rxMarcro, &rxMatch)) {
         addNode(MacroNode, rxMatch.captured(1), m_lineNumber);
     }
-
-    removeTrailingSharpComment();
-    removeTrailingDoubleSlashComment();
 }
 
 // kate: space-indent on; indent-width 4; replace-tabs on;
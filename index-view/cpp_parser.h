@@ -56,11 +56,11 @@ protected:
     QString version() override { return QStringLiteral("0.9.2, Jul 2025"); } ;
     QString author() override { return QStringLiteral("2018, 2022, 2025 loh.tar \n\nInspired by \n2003 Massimo Callegari"); } ;
 
+    void prepareForParse() override;
     void parseDocument() override;
     bool lineIsGood() override;
     bool appendNextLine() override;
-    void removeStrings() override;
-    void removeComment() override;
+    void stripLine() override;
 
     void addAccessSpecNode(const QString &accessSpec);
     void addFuncDefNode(const QString &retType, const QString &nameSpace, const QString &funcName);
@@ -19,7 +19,11 @@
  */
 
 
+#include <algorithm>
+
 #include <QDebug>
+#include <QThread>
+#include <QtConcurrent>
 
 #include <KLocalizedString>
 
@@ -43,38 +47,34 @@ DocumentParser::~DocumentParser()
 }
 
 
-void DocumentParser::parse()
+void DocumentParser::finishParse()
 {
-    const QString checksum = disableDependentOptions();
-
-    Parser::parse();
-
-    // Hiding not useful options is surprising tricky, we need to parse twice
-    // in some cases to ensure everything works as desired
-    if (checksum != disableDependentOptions()) {
-        Parser::parse();
+    if (lastNode() != NoNode) {
+        setNodeEndLine(lastNode(), lineNumber() - 1);
     }
 
-    if (lastNode()) {
-        lastNode()->setData(0, NodeData::EndLine, lineNumber() - 1);
-    }
+    // Not needed anymore, free the memory
+    p_lineTypes.clear();
+
+    Parser::finishParse();
 }
 
 
 bool DocumentParser::nextLine()
 {
+    if (passCheckpoint()) {
+        return false;
+    }
+
     while (true) {
         // Run the loop one line more as usually needed...
-        if (p_lineNumber >= (p_document->lines() + 1)) {
+        if (p_lineNumber >= (documentSize() + 1)) {
             return false;
         }
 
         // ...to ensure a last paragraph is added properly...
-        if (p_lineNumber < p_document->lines()) {
-            m_line = nextLineOrBust();
-            m_line = m_line.trimmed();
-            m_line = m_line.simplified();
-            m_line.truncate(80); // Limit the size to some acceptable length
+        if (p_lineNumber < documentSize()) {
+            m_line = simplifiedLine(nextLineOrBust());
         } else {
             ++p_lineNumber;
             if (m_paraLineNumber == -1) {
@@ -105,16 +105,97 @@ bool DocumentParser::nextLine()
 }
 
 
+QString DocumentParser::simplifiedLine(QStringView line)
+{
+    QString simplified = line.trimmed().toString().simplified();
+    simplified.truncate(80); // Limit the size to some acceptable length
+
+    return simplified;
+}
+
+
+void DocumentParser::classifyLines()
+{
+    // Nothing classified yet, lineType() will start here
+    p_lineTypesBegin = p_lineNumber;
+    p_lineTypes.clear();
+}
+
+
+int DocumentParser::lineType()
+{
+    const int line = lineNumber();
+    if (line >= documentSize()) {
+        return IgnoredLine;
+    }
+
+    const int index = line - p_lineTypesBegin;
+    if (index >= 0 && index < p_lineTypes.size()) {
+        return p_lineTypes.at(index);
+    }
+
+    // Behind the current batch, replace it by the next one. The lines of the old
+    // one are done, so its memory can be reused
+    const int batchSize = ClassifyChunk_Size * ClassifyBatch_Chunks * qMax(1, QThread::idealThreadCount());
+    p_lineTypesBegin = line;
+    const int count = qMin(batchSize, documentSize() - p_lineTypesBegin);
+    p_lineTypes.fill(IgnoredLine, count);
+
+    // Each chunk write only its own part, no need to lock or detach anything
+    int *lineTypes = p_lineTypes.data();
+    auto classifyChunk = [this, lineTypes, count](const int first) {
+        if (p_cancelParse.loadRelaxed()) {
+            return;
+        }
+        const int last = qMin(first + ClassifyChunk_Size, count);
+        for (int i = first; i < last; ++i) {
+            lineTypes[i] = classifyLine(p_lines.line(p_lineTypesBegin + i));
+        }
+    };
+
+    if (count <= ClassifyChunk_Size) {
+        // Not worth the overhead
+        classifyChunk(0);
+    } else {
+        QList<int> chunks;
+        for (int first = 0; first < count; first += ClassifyChunk_Size) {
+            chunks.append(first);
+        }
+        QtConcurrent::blockingMap(chunks, classifyChunk);
+    }
+
+    return p_lineTypes.first();
+}
+
+
+QList<QAction *> DocumentParser::nodeTypeOptions() const
+{
+    // Node types without an option, like the root or the git conflicts, are
+    // not part of the chain but must not stop it
+    QList<int> nodeTypes;
+    for (auto it = p_nodeTypes.constBegin(); it != p_nodeTypes.constEnd(); ++it) {
+        if (it.key() >= RootNode && it.key() < FirstCommentTagNode && it.value().option) {
+            nodeTypes.append(it.key());
+        }
+    }
+    std::sort(nodeTypes.begin(), nodeTypes.end());
+
+    QList<QAction *> viewOptions;
+    for (const int nodeType : std::as_const(nodeTypes)) {
+        viewOptions.append(p_nodeTypes.value(nodeType).option);
+    }
+
+    return viewOptions;
+}
+
+
 QString DocumentParser::disableDependentOptions()
 {
     QString checksum;
     bool    somePrevIsAvailable = true;
 
-    for(int i = 0; true; i++) {
-        QAction *viewOption = p_nodeTypes.value(i).option;
-        if (!viewOption) {
-            break;
-        }
+    const QList<QAction *> viewOptions = nodeTypeOptions();
+    for (QAction *viewOption : viewOptions) {
         if (!viewOption->isVisible()) {
             continue;
         }
@@ -132,9 +213,18 @@ QString DocumentParser::disableDependentOptions()
 
 void DocumentParser::prepareForParse()
 {
+    // Which option depends on which is only known when it's known which are useful,
+    // so updateDependentOptions() decide that after the run and until then is each
+    // node only wanted by its own option. This way one parsing run is enough
+    const QList<QAction *> viewOptions = nodeTypeOptions();
+    for (QAction *viewOption : viewOptions) {
+        viewOption->setEnabled(true);
+    }
+    takeOptionSnapshot();
+
     resetNesting();
 
-    p_indexTree->setRootIsDecorated(1);
+    setRootIsDecorated(true);
 
     QString fileName = document()->url().fileName();
     if (fileName.isEmpty()) {
@@ -143,44 +233,76 @@ void DocumentParser::prepareForParse()
     // Add the root node here keeps addNode() less complex
     // Using line number 0 will cause a jump to the top of the document when
     // clicked which make absolutely sense.
-    QTreeWidgetItem *node = rootNode(RootNode);
+    const int node = rootNode(RootNode);
     setNodeProperties(node, RootNode, fileName, 0);
 }
 
 
+void DocumentParser::saveScanState(ScanState &state) const
+{
+    Parser::saveScanState(state);
+
+    state.addLine(m_paraLineNumber);
+    // Without a pending paragraph is the line only an outdated leftover
+    state.addText(m_paraLineNumber < 0 ? QString() : m_paraLine);
+    state.addValue(p_historySize);
+    state.addValue(m_lineHistory.size());
+    for (int i = 0; i < m_lineHistory.size(); ++i) {
+        state.addValue(m_lineTypeHistory.at(i));
+        state.addText(m_lineHistory.at(i));
+    }
+}
+
+
+void DocumentParser::restoreScanState(ScanState &state)
+{
+    Parser::restoreScanState(state);
+
+    m_paraLineNumber = state.takeLine();
+    m_paraLine = state.takeText();
+    p_historySize = state.takeValue();
+    m_lineTypeHistory.clear();
+    m_lineHistory.clear();
+    for (int i = state.takeValue(); i > 0; --i) {
+        m_lineTypeHistory.enqueue(state.takeValue());
+        m_lineHistory.enqueue(state.takeText());
+    }
+}
+
+
 void DocumentParser::fnishEndlines()
 {
-    QTreeWidgetItem *node = lastNode();
-    while (node) {
-        //qDebug() << "fnishEndlines UPDATE EndLine" << node->text(0) << "from" << node->data(0, NodeData::EndLine).toInt() << "to" << lineNumber() -1;
-        node->setData(0, NodeData::EndLine, lineNumber() - 1);
-        node = node->parent();
+    int node = lastNode();
+    while (node != NoNode) {
+        //qDebug() << "fnishEndlines UPDATE EndLine" << nodeText(node) << "from" << nodeEndLine(node) << "to" << lineNumber() -1;
+        setNodeEndLine(node, lineNumber() - 1);
+        node = nodeParent(node);
     }
 }
 
 
 void DocumentParser::addNode(const int nodeType, const QString &text, const int lineNumber)
 {
-    QTreeWidgetItem *node = nullptr;
+    int node = NoNode;
 
     // Indicate, there is no paragraph waiting for completion
     m_paraLineNumber = -1;
 
-    if (lastNode()) {
+    if (lastNode() != NoNode) {
         ++p_nestingLevel;
-        QTreeWidgetItem *parentNode = lastNode();
-        //qDebug() << "UPDATE   LAST" << parentNode->text(0) << "from" << parentNode->data(0, NodeData::EndLine).toInt() << "to" << fromLine -1;
-        parentNode->setData(0, NodeData::EndLine, lineNumber - 1);
-        while (parentNode->type() >= nodeType) {
-            parentNode = parentNode->parent();
-            //qDebug() << "UPDATE PARENT" << parentNode->text(0) << "from" << parentNode->data(0, NodeData::EndLine).toInt() << "to" << lineNumber -1;
-            parentNode->setData(0, NodeData::EndLine, lineNumber - 1);
+        int parentNode = lastNode();
+        //qDebug() << "UPDATE   LAST" << nodeText(parentNode) << "from" << nodeEndLine(parentNode) << "to" << fromLine -1;
+        setNodeEndLine(parentNode, lineNumber - 1);
+        while (nodeTypeOf(parentNode) >= nodeType) {
+            parentNode = nodeParent(parentNode);
+            //qDebug() << "UPDATE PARENT" << nodeText(parentNode) << "from" << nodeEndLine(parentNode) << "to" << lineNumber -1;
+            setNodeEndLine(parentNode, lineNumber - 1);
             --p_nestingLevel;
         }
-        node = new QTreeWidgetItem(parentNode, nodeType);
+        node = newNode(parentNode, nodeType);
     } else {
         qDebug() << "DocumentParser::addNode - surprising, should never happens!";
-        node = new QTreeWidgetItem(p_indexTree, nodeType);
+        node = newNode(NoNode, nodeType);
     }
 
     setNodeProperties(node, nodeType, text, lineNumber);
@@ -188,32 +310,24 @@ void DocumentParser::addNode(const int nodeType, const QString &text, const int
 }
 
 
-QTreeWidgetItem *DocumentParser::addLimbToNode(int firstNodeType, int lastNodeType, const QStringList &nodeList, QTreeWidgetItem *branchNode/* = nullptr*/)
+int DocumentParser::addLimbToNode(int firstNodeType, int lastNodeType, const QStringList &nodeList, int branchNode/* = NoNode*/)
 {
-    if (!branchNode) {
+    if (branchNode == NoNode) {
         branchNode = rootNode(RootNode);
     }
 
-//     auto addNodeToParent = [this](int nodeType, QTreeWidgetItem *parentNode, const QString &text) {
-//         QTreeWidgetItem *node = new QTreeWidgetItem(parentNode, nodeType);
+//     auto addNodeToParent = [this](int nodeType, int parentNode, const QString &text) {
+//         int node = newNode(parentNode, nodeType);
 //         setNodeProperties(node, nodeType, text, lineNumber());
 //         return lastNode();
 //     };
 
-    QTreeWidgetItem *node = branchNode;
+    int node = branchNode;
     int i = 0;
-    bool sectionExist = false;
     while (i < nodeList.size()) {
-        for (int j = 0; j < node->childCount(); ++j) {
-            //                 qDebug() << "COMPARE" << i << j << node->child(j)->text(0) << nodeList.at(i);
-            if (node->child(j)->text(0) == nodeList.at(i)) {
-                node = node->child(j);
-                sectionExist = true;
-                break;
-            }
-        }
-        if (!sectionExist) {
-            lastNode()->setData(0, NodeData::EndLine, lineNumber() - 1);
+        const int child = findChild(node, nodeList.at(i));
+        if (child == NoNode) {
+            setNodeEndLine(lastNode(), lineNumber() - 1);
             int nodeType = firstNodeType;
             for (int k = i; k < nodeList.size(); ++k) {
                 node = addNodeToParent(k+1, node, nodeList.at(k));
@@ -221,22 +335,22 @@ QTreeWidgetItem *DocumentParser::addLimbToNode(int firstNodeType, int lastNodeTy
             }
             break;
         }
-        sectionExist = false;
+        node = child;
         ++i;
     }
 
     return lastNode();
 }
 
-QTreeWidgetItem *DocumentParser::addNodeToParent(int nodeType, QTreeWidgetItem *parentNode, const QString &text)
+int DocumentParser::addNodeToParent(int nodeType, int parentNode, const QString &text)
 {
-    if (!parentNode) {
-        qDebug() << "DocumentParser::addNodeToParent FATAL parent is nullptr" << text << "type" << nodeType;
+    if (parentNode == NoNode) {
+        qDebug() << "DocumentParser::addNodeToParent FATAL parent is NoNode" << text << "type" << nodeType;
 //     } else {
-//         qDebug() << "ADD " << text << "type" << nodeType << "TO" << parentNode->text(0);
+//         qDebug() << "ADD " << text << "type" << nodeType << "TO" << nodeText(parentNode);
     }
 
-    QTreeWidgetItem *node = new QTreeWidgetItem(parentNode, nodeType);
+    const int node = newNode(parentNode, nodeType);
     setNodeProperties(node, nodeType, text, lineNumber());
 
     return lastNode();
@@ -27,6 +27,16 @@
 class IndexView;
 class KatePluginIndexView;
 
+/**
+ * Lines classified in one go by a pool thread, see DocumentParser::lineType()
+ */
+static const int ClassifyChunk_Size = 4096;
+
+/**
+ * Chunks classified at once for each pool thread, see DocumentParser::lineType()
+ */
+static const int ClassifyBatch_Chunks = 2;
+
 /**
  * The \p DocumentParser master class offer features for human readable files.
  *
@@ -39,8 +49,6 @@ public:
     DocumentParser(QObject *view, KTextEditor::Document *doc);
    ~DocumentParser();
 
-   virtual void parse() override;
-
 protected:
 
     /**
@@ -67,9 +75,40 @@ protected:
     * This function iterate with each call over the document and set @c m_line to
     * the next non empty line. Whereby some lines are treat as empty, like lines
     * with only a single char and lines matching @c m_rxIgnoreLine.
+    * Before the next line is read is Parser::passCheckpoint() called, so don't keep
+    * any state in local variables of parseDocument() but in members which are added
+    * by saveScanState().
     */
     virtual bool nextLine();
 
+    /**
+    * @return @p line as nextLine() set it to @c m_line
+    */
+    static QString simplifiedLine(QStringView line);
+
+    /**
+    * Called by lineType() for each raw line of the document, may be from more
+    * than one thread at the same time. So don't touch any member here, only look
+    * at @p line, which don't depend on its neighbours.
+    * @return the type of @p line, should be enum LineType
+    */
+    virtual int classifyLine(QStringView line) const { Q_UNUSED(line) return IgnoredLine; };
+
+    /**
+    * Call this at the begin of parseDocument() to let lineType() classify the lines
+    * by classifyLine(), starting at the current one. No line is classified here, but
+    * lineType() does it ahead in batches of lines which are split into chunks and run
+    * in parallel on the thread pool. So a parsing run which stop early, like a chunk
+    * run or a canceled one, don't pay for the rest of the document.
+    */
+    void classifyLines();
+
+    /**
+    * @return the type of the current line as found by classifyLine(), or
+    * @c IgnoredLine behind the end of the document
+    */
+    int lineType();
+
     /**
     * Add a new node to the index view with respect of current view settings.
     * @param nodeType the type of the new node, like header or paragraph
@@ -79,13 +118,28 @@ protected:
     virtual void addNode(const int nodeType, const QString &text, const int lineNumber);
 
     /**
-    * This function is called twice by parse() to ensure that not only all useful
-    * options are visible but also that nothing is undesired skipped by parse().
+    * @return the view options of our node types, in the order of their types
+    */
+    QList<QAction *> nodeTypeOptions() const;
+
+    /**
+    * This function is called by updateDependentOptions() to enable each visible
+    * option only when all visible options in front of it are checked.
     * @return a checksum which depend on visible view options
     */
     virtual QString disableDependentOptions();
 
+    void updateDependentOptions() override { disableDependentOptions(); };
+
     virtual void prepareForParse() override;
+    virtual void finishParse() override;
+
+    /**
+    * The paragraph and the history are added to the @p state.
+    * @see Parser::saveScanState()
+    */
+    virtual void saveScanState(ScanState &state) const override;
+    virtual void restoreScanState(ScanState &state) override;
 
     /**
      * Call this function at the of parseDocument() to ensure in a true tree all
@@ -99,7 +153,8 @@ protected:
     * history with empty lines. This function is typically called at the begin of
     * parsing with a suitable @p size but you may also call it depended on the
     * current parsed line in which case you can omit @p size to keep the buffer
-    * size unchanged.
+    * size unchanged. Call this with a @p size in prepareForParse(), not in
+    * parseDocument(), which may start at some checkpoint.
     * @param size is the number of lines to keep in the history
     */
     void initHistory(int size = -1);
@@ -113,13 +168,16 @@ protected:
     */
     void addToHistory(int lineType, const QString &line);
 
-    int                      m_paraLineNumber;    // Where the current paragraph begins
+    int                      m_paraLineNumber = -1; // Where the current paragraph begins
+    QString                  m_paraLine;          // First line of the current paragraph
     QQueue<int>              m_lineTypeHistory;
     QQueue<QString>          m_lineHistory;
     QRegularExpression       m_rxIgnoreLine = QRegularExpression(QStringLiteral("^[-#*./]{1,2}$"));
 
 private:
-    int                      p_historySize;
+    int                      p_historySize = 0;
+    QList<int>               p_lineTypes;         // The current batch of lineType()
+    int                      p_lineTypesBegin = 0; // The line of p_lineTypes.first()
 
 protected:
 
@@ -129,13 +187,13 @@ protected:
      * reached. Each further node uses @p lastNodeType too.
      * @return the last added node from the list, or even the found one in the tree
      */
-    QTreeWidgetItem *addLimbToNode(int firstNodeType, int lastNodeType, const QStringList &nodeList, QTreeWidgetItem *branchNode= nullptr);
+    int addLimbToNode(int firstNodeType, int lastNodeType, const QStringList &nodeList, int branchNode = NoNode);
 
     /**
      * Add a new node @p text to the tree below @p parentNode as @p nodeType.
      * @return the new added node
      */
-    QTreeWidgetItem *addNodeToParent(int nodeType, QTreeWidgetItem *parentNode, const QString &text);
+    int addNodeToParent(int nodeType, int parentNode, const QString &text);
 };
 
 #endif
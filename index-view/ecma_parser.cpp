@@ -44,6 +44,8 @@ EcmaParser::EcmaParser(QObject *view, KTextEditor::Document *doc)
     m_rxFunc3 = QRegularExpression(QStringLiteral("\\b(\\w+):function\\((.*)\\)"));
     // Must match against m_niceLine, so consider spaces
     m_rxFunc4 = QRegularExpression(QStringLiteral("\\[\'(\\w+)\'\\]\\s?=\\s?function\\((.*)\\)"));
+
+    useLexer(DoubleQuotedStrings | SingleQuotedStrings | SlashStarComments | DoubleSlashComments);
 }
 
 
@@ -105,17 +107,4 @@ bool EcmaParser::lineIsGood()
 }
 
 
-void EcmaParser::removeStrings()
-{
-    removeSingleQuotedStrings();
-    removeDoubleQuotedStrings();
-}
-
-
-void EcmaParser::removeComment()
-{
-    removeMultiLineSlashStarComment();
-    removeTrailingDoubleSlashComment();
-}
-
 // kate: space-indent on; indent-width 4; replace-tabs on;
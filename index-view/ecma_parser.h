@@ -53,8 +53,6 @@ protected:
 
     void parseDocument() override;
     bool lineIsGood() override;
-    void removeStrings() override;
-    void removeComment() override;
 
     QRegularExpression m_rxFunction;
     QRegularExpression m_rxFunc2;
@@ -59,9 +59,38 @@ FortranParser::~FortranParser()
 }
 
 
-void FortranParser::parseDocument()
+void FortranParser::prepareForParse()
+{
+    m_BlockStack.clear();
+
+    ProgramParser::prepareForParse();
+}
+
+
+void FortranParser::saveScanState(ScanState &state) const
+{
+    ProgramParser::saveScanState(state);
+
+    state.addValue(m_BlockStack.size());
+    for (const QString &type : m_BlockStack) {
+        state.addText(type);
+    }
+}
+
+
+void FortranParser::restoreScanState(ScanState &state)
 {
+    ProgramParser::restoreScanState(state);
+
     m_BlockStack.clear();
+    for (int i = state.takeValue(); i > 0; --i) {
+        m_BlockStack.push(state.takeText());
+    }
+}
+
+
+void FortranParser::parseDocument()
+{
     QRegularExpressionMatch rxMatch;
 
     while (nextInstruction()) {
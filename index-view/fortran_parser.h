@@ -51,6 +51,9 @@ protected:
     QString version() override { return QStringLiteral("0.6.2, Jul 2022"); } ;
     QString author() override { return QStringLiteral("2018 loh.tar \n\nInspired by \n2005 Roberto Quitiliani"); } ;
 
+    void prepareForParse() override;
+    void saveScanState(ScanState &state) const override;
+    void restoreScanState(ScanState &state) override;
     void parseDocument() override;
     bool lineIsGood() override { return true; };
     void removeStrings() override;
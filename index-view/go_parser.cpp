@@ -36,6 +36,8 @@ GoParser::GoParser(QObject *view, KTextEditor::Document *doc)
     registerViewOption(InterfaceNode, InterfaceIcon, QStringLiteral("Interfaces"), i18n("Show Interfaces"));
     registerViewOption(FuncNode, FuncDefIcon, QStringLiteral("Functions"), i18n("Show Functions"));
 //     registerViewOption(VariableNode, VariableIcon, QStringLiteral("Variable"), i18n("Show Variables"));
+
+    useLexer(DoubleQuotedStrings | BackQuotedStrings | SlashStarComments | DoubleSlashComments);
 }
 
 
@@ -44,6 +46,41 @@ GoParser::~GoParser()
 }
 
 
+void GoParser::prepareForParse()
+{
+    p_types.clear();
+
+    ProgramParser::prepareForParse();
+}
+
+
+void GoParser::saveScanState(ScanState &state) const
+{
+    ProgramParser::saveScanState(state);
+
+    // Sorted, so that equal types give an equal state
+    QStringList types = p_types.keys();
+    types.sort();
+    state.addValue(types.size());
+    for (const QString &type : std::as_const(types)) {
+        state.addText(type);
+        state.addNode(p_types.value(type));
+    }
+}
+
+
+void GoParser::restoreScanState(ScanState &state)
+{
+    ProgramParser::restoreScanState(state);
+
+    p_types.clear();
+    for (int i = state.takeValue(); i > 0; --i) {
+        const QString type = state.takeText();
+        p_types.insert(type, state.takeNode());
+    }
+}
+
+
 void GoParser::parseDocument()
 {
     static const QRegularExpression rxStruct(QStringLiteral(R"(^type (\w+) struct)"));
@@ -54,8 +91,6 @@ void GoParser::parseDocument()
 
     QRegularExpressionMatch rxMatch;
 
-    p_types.clear();
-
     while (nextInstruction()) {
 
         if (m_line.contains(rxStruct, &rxMatch)) {
@@ -85,17 +120,17 @@ void GoParser::parseDocument()
 
 void GoParser::addFuncToType(const QString &typeName, const QString &funcName)
 {
-    auto structNode = p_types.value(typeName, nullptr);
-    if (!structNode) {
+    const int structNode = p_types.value(typeName, NoNode);
+    if (structNode == NoNode) {
         // qDebug() << "FATAL: No p_types.value" << typeName;
         return;
     }
 
-    auto *node = new QTreeWidgetItem(structNode, FuncNode);
-    if (showAsTree()) {
+    const int node = newNode(structNode, FuncNode);
+    if (parseAsTree()) {
         setNodeProperties(node, FuncNode, funcName, m_lineNumber);
     } else {
-        setNodeProperties(node, FuncNode, structNode->text(0) + QStringLiteral(".") + funcName, m_lineNumber);
+        setNodeProperties(node, FuncNode, nodeText(structNode) + QStringLiteral(".") + funcName, m_lineNumber);
     }
 }
 
@@ -107,17 +142,4 @@ bool GoParser::lineIsGood()
 }
 
 
-void GoParser::removeStrings()
-{
-    removeDoubleQuotedStrings();
-    // FIXME Go use also back quotes, as in `foo`. Add a function to ProgramParser if needed
-}
-
-
-void GoParser::removeComment()
-{
-    removeMultiLineSlashStarComment();
-    removeTrailingDoubleSlashComment();
-}
-
 // kate: space-indent on; indent-width 4; replace-tabs on;
@@ -49,15 +49,16 @@ protected:
     QString version() override { return QStringLiteral("0.6, Jul 2025"); } ;
     QString author() override { return QStringLiteral("2025 loh.tar"); } ;
 
+    void prepareForParse() override;
+    void saveScanState(ScanState &state) const override;
+    void restoreScanState(ScanState &state) override;
     void parseDocument() override;
     void addFuncToType(const QString &typeName, const QString &funcName);
 
     bool lineIsGood() override;
-    void removeStrings() override;
-    void removeComment() override;
 
     // QAction                                 *m_showParameters; // FIXME if you really need need it
-    QHash<QString, QTreeWidgetItem*>            p_types; // For easy adding of functions to types
+    QHash<QString, int>                         p_types; // For easy adding of functions to types
 };
 
 #endif
@@ -28,19 +28,44 @@
 // I have not replaced these construct of hard coded bitmaps by the typical resource
 // approach. Anyone knows why that was not done?
 
+#include <cmath>
+
+#include <QGuiApplication>
+#include <QHash>
 #include <QIcon>
 #include <QPainter>
+#include <QScreen>
 #include <QDebug>
 
 #include "icon_collection.h"
 
 namespace IconCollection {
 
-QIcon getIcon(const int size/* = -1 */, const int qtGlobalColorEnum/* = -1 */, const qreal scale/* = 1.0*/)
+/**
+ * @return the device pixel ratios of all screens and 1.0, in ascending order
+ */
+static QList<qreal> devicePixelRatios()
 {
-    static int autoColor = 0;
-    const static QList<int> autoColors = { Qt::blue, Qt::red, Qt::green, Qt::cyan, Qt::magenta, Qt::yellow, Qt::gray };
+    QList<qreal> ratios = { 1.0 };
+
+    const QList<QScreen *> screens = QGuiApplication::screens();
+    for (const QScreen *screen : screens) {
+        if (!ratios.contains(screen->devicePixelRatio())) {
+            ratios.append(screen->devicePixelRatio());
+        }
+    }
+    std::sort(ratios.begin(), ratios.end());
 
+    return ratios;
+}
+
+
+/**
+ * Paint the icon for one device pixel ratio, the drawing itself is done in device
+ * independent pixels, so it's crisp on a HiDPI screen.
+ */
+static QPixmap renderPixmap(const int size, const QColor &color, const qreal scale, const qreal ratio)
+{
     const qreal pixmapSize = 24.0 * scale;
     const qreal pixmapHalf = pixmapSize / 2.0;
     const qreal penWidth = 1.0;
@@ -48,28 +73,13 @@ QIcon getIcon(const int size/* = -1 */, const int qtGlobalColorEnum/* = -1 */, c
     const qreal bigCircleSize = (pixmapSize / 4.0) * 1.2 - penWidth;
     //const qreal circleHalf = circleSize / 2.0;
 
-    QPixmap pixmap(pixmapSize,pixmapSize);
+    const int deviceSize = std::ceil(pixmapSize * ratio);
+    QPixmap pixmap(deviceSize, deviceSize);
+    pixmap.setDevicePixelRatio(ratio);
     pixmap.fill(Qt::transparent);
 
     if (size < 1) {
-        // No error, just reset our auto color counter
-        autoColor = 0;
-        return QIcon(pixmap);
-    }
-
-    QColor color;
-    if (qtGlobalColorEnum < 0) {
-        color = QColor((Qt::GlobalColor)autoColors.at(autoColor++));
-        if (autoColors.size() == autoColor) {
-            autoColor = 0;
-        }
-    } else {
-        color = QColor((Qt::GlobalColor)qtGlobalColorEnum);
-    }
-
-    if (color == QColor(Qt::blue)) {
-        // Blue looks too dark for my taste
-        color = color.lighter(130);
+        return pixmap;
     }
 
     QPainter painter(&pixmap);
@@ -106,7 +116,55 @@ QIcon getIcon(const int size/* = -1 */, const int qtGlobalColorEnum/* = -1 */, c
         painter.drawEllipse(QPointF(pixmapHalf/* + circleSize*/, pixmapHalf), bigCircleSize, bigCircleSize);
     }
 
-    return QIcon(pixmap);
+    return pixmap;
+}
+
+
+QIcon getIcon(const int size/* = -1 */, const int qtGlobalColorEnum/* = -1 */, const qreal scale/* = 1.0*/)
+{
+    static int autoColor = 0;
+    const static QList<int> autoColors = { Qt::blue, Qt::red, Qt::green, Qt::cyan, Qt::magenta, Qt::yellow, Qt::gray };
+
+    // Each parser ask for the same few icons, so these are painted only once and shared by all
+    static QHash<QString, QIcon> cache;
+
+    QColor color;
+    if (size < 1) {
+        // No error, just reset our auto color counter
+        autoColor = 0;
+    } else if (qtGlobalColorEnum < 0) {
+        color = QColor((Qt::GlobalColor)autoColors.at(autoColor++));
+        if (autoColors.size() == autoColor) {
+            autoColor = 0;
+        }
+    } else {
+        color = QColor((Qt::GlobalColor)qtGlobalColorEnum);
+    }
+
+    if (color == QColor(Qt::blue)) {
+        // Blue looks too dark for my taste
+        color = color.lighter(130);
+    }
+
+    // A screen may be added at any time, then are the icons also painted for it
+    const QList<qreal> ratios = devicePixelRatios();
+    QString key = QStringLiteral("%1 %2 %3").arg(qMax(0, size)).arg(color.rgba()).arg(scale);
+    for (const qreal ratio : ratios) {
+        key += QStringLiteral(" %1").arg(ratio);
+    }
+
+    const auto it = cache.constFind(key);
+    if (it != cache.constEnd()) {
+        return it.value();
+    }
+
+    QIcon icon;
+    for (const qreal ratio : ratios) {
+        icon.addPixmap(renderPixmap(size, color, scale, ratio));
+    }
+    cache.insert(key, icon);
+
+    return icon;
 }
 
 
@@ -110,6 +110,9 @@ QIcon getIcon(IconType type);
  * When called only with a size argument is a color auto chosen from an intern list
  * of Qt::GlobalColor. With each such auto gen call is an other color used. When no
  * new color is available the frst known color is used again.
+ * The icon hold a pixmap for each device pixel ratio of the screens and is painted only
+ * once, later calls with the same arguments and resulting color return the cached one.
+ * @note Like all pixmap stuff only usable in the GUI thread
  * @parm size How many circle to use 1-3 or -1 to reset auto color counter
  * @parm qtGlobalColorEnum A color from Qt::GlobalColor or -1 for auto color
  * @parm scale A factor to adjust the dimension of the icon, only used for plugin icon
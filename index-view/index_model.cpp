@@ -0,0 +1,615 @@
+/*   This file is part of KatePlugin-IndexView
+ *
+ *   IndexModel Class
+ *   Copyright (C) 2018 loh.tar@googlemail.com
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Library General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Library General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include <algorithm>
+
+#include <QVarLengthArray>
+
+#include "index_model.h"
+
+
+IndexModel::IndexModel(QObject *parent)
+    : QAbstractItemModel(parent)
+{
+}
+
+
+IndexModel::~IndexModel()
+{
+}
+
+
+void IndexModel::setNodes(const QList<IndexNode> &nodes, const QList<int> &topLevelNodes, bool asTree)
+{
+    beginResetModel();
+    buildLayout(nodes, topLevelNodes, asTree);
+    buildPositionIndex();
+    p_sorted = false;
+    endResetModel();
+}
+
+
+QList<int> IndexModel::updateNodes(const QList<IndexNode> &nodes, const QList<int> &topLevelNodes, bool asTree)
+{
+    Layout oldLayout;
+    swapLayout(oldLayout);
+    buildLayout(nodes, topLevelNodes, asTree);
+    buildPositionIndex();
+    if (p_sorted) {
+        sortLayout();
+    }
+
+    // The old nodes grouped by their parent and type, then by their text, where each
+    // list is in order of appearance. The position in that list is the ordinal of a node
+    QHash<QPair<int, int>, QHash<QString, QList<int>>> oldNodes;
+    for (int i = 0; i < oldLayout.nodes.size(); ++i) {
+        const Node &node = oldLayout.nodes.at(i);
+        if (node.row < 0) {
+            continue;
+        }
+        oldNodes[qMakePair(node.parent, node.type)][oldLayout.texts.at(node.textId)].append(i);
+    }
+
+    // Parents are always in front of their children, so they are already matched
+    QList<int> addedNodes;
+    QList<int> oldToNew(oldLayout.nodes.size(), -1);
+    QList<int> newToOld(p_nodes.size(), -1);
+    bool sameLayout = p_children.size() == oldLayout.children.size();
+    QHash<QPair<int, int>, QHash<QString, int>> ordinals;
+    for (int i = 0; i < p_nodes.size(); ++i) {
+        const Node &node = p_nodes.at(i);
+        if (node.row < 0) {
+            continue;
+        }
+
+        int parent = -1;
+        if (node.parent != -1) {
+            parent = newToOld.at(node.parent);
+            if (parent == -1) {
+                // Below a new node can only be new nodes
+                addedNodes.append(i);
+                sameLayout = false;
+                continue;
+            }
+        }
+
+        const QPair<int, int> group = qMakePair(parent, node.type);
+        const QString &text = p_texts.at(node.textId);
+        const int oldNode = oldNodes.value(group).value(text).value(ordinals[group][text]++, -1);
+        if (oldNode == -1) {
+            addedNodes.append(i);
+            sameLayout = false;
+            continue;
+        }
+
+        newToOld[i] = oldNode;
+        oldToNew[oldNode] = i;
+        if (oldNode != i || oldLayout.nodes.at(oldNode).row != node.row) {
+            sameLayout = false;
+        }
+    }
+
+    if (sameLayout) {
+        // Only the data of some rows may have changed, report each block of rows at once
+        QHash<int, QPair<int, int>> changedRows; // By parent node
+        for (int i = 0; i < p_nodes.size(); ++i) {
+            const Node &node = p_nodes.at(i);
+            if (node.row < 0) {
+                continue;
+            }
+            const Node &oldNode = oldLayout.nodes.at(i);
+            if (node.line == oldNode.line && node.column == oldNode.column
+                && node.endLine == oldNode.endLine && node.iconType == oldNode.iconType) {
+                continue;
+            }
+            auto it = changedRows.find(node.parent);
+            if (it == changedRows.end()) {
+                changedRows.insert(node.parent, qMakePair(node.row, node.row));
+            } else {
+                it.value().first = qMin(it.value().first, node.row);
+                it.value().second = qMax(it.value().second, node.row);
+            }
+        }
+
+        const QList<int> roles = {Qt::DecorationRole, NodeData::Line, NodeData::Column, NodeData::EndLine};
+        for (auto it = changedRows.constBegin(); it != changedRows.constEnd(); ++it) {
+            const QModelIndex parent = indexOf(it.key());
+            Q_EMIT dataChanged(index(it.value().first, 0, parent), index(it.value().second, 0, parent), roles);
+        }
+
+        return addedNodes;
+    }
+
+    // The views must see the old content when they are informed about the change
+    swapLayout(oldLayout);
+    Q_EMIT layoutAboutToBeChanged();
+    const QModelIndexList oldIndexes = persistentIndexList();
+    swapLayout(oldLayout);
+
+    QModelIndexList newIndexes;
+    newIndexes.reserve(oldIndexes.size());
+    for (const QModelIndex &index : oldIndexes) {
+        newIndexes.append(indexOf(oldToNew.value(nodeOf(index), -1)));
+    }
+    changePersistentIndexList(oldIndexes, newIndexes);
+
+    Q_EMIT layoutChanged();
+
+    return addedNodes;
+}
+
+
+void IndexModel::setHeaderText(const QString &text)
+{
+    if (p_headerText == text) {
+        return;
+    }
+
+    p_headerText = text;
+    Q_EMIT headerDataChanged(Qt::Horizontal, 0, 0);
+}
+
+
+void IndexModel::swapLayout(Layout &other)
+{
+    p_nodes.swap(other.nodes);
+    p_children.swap(other.children);
+    std::swap(p_topLevelCount, other.topLevelCount);
+    p_texts.swap(other.texts);
+    p_listedNodes.swap(other.listedNodes);
+}
+
+
+void IndexModel::buildLayout(const QList<IndexNode> &nodes, const QList<int> &topLevelNodes, bool asTree)
+{
+    p_nodes.clear();
+    p_children.clear();
+    p_texts.clear();
+    p_listedNodes.clear();
+    p_topLevelCount = 0;
+    p_foldedTexts.clear();
+    p_filterPattern.clear();
+    p_filterHits.clear();
+
+    p_nodes.resize(nodes.size());
+
+    // Repeated captions, like "public:" or overloaded functions, are stored only once
+    QHash<QString, int> textIds;
+    for (int i = 0; i < nodes.size(); ++i) {
+        const IndexNode &node = nodes.at(i);
+        auto it = textIds.constFind(node.text);
+        if (it == textIds.constEnd()) {
+            it = textIds.insert(node.text, p_texts.size());
+            p_texts.append(node.text);
+        }
+        Node &item = p_nodes[i];
+        item.textId = it.value();
+        item.type = node.type;
+        item.iconType = node.iconType;
+        item.line = node.line;
+        item.column = node.column;
+        item.endLine = node.endLine;
+    }
+
+    if (!asTree) {
+        // To offer a plain list of our hard-raised tree we only need the nodes of
+        // interest, in the order they were found, no matter if their parents are shown
+        for (int i = 0; i < nodes.size(); ++i) {
+            if (nodes.at(i).listed && !nodes.at(i).hidden) {
+                p_nodes[i].row = p_children.size();
+                p_children.append(i);
+                p_listedNodes.append(i);
+            }
+        }
+        p_topLevelCount = p_children.size();
+        return;
+    }
+
+    // Count the children of each node, so that each one get its range in p_children.
+    // Parents are always in front of their children, so we know already if they are shown
+    for (int i = 0; i < nodes.size(); ++i) {
+        const IndexNode &node = nodes.at(i);
+        if (node.hidden || (node.parent != -1 && p_nodes.at(node.parent).row < 0)) {
+            continue;
+        }
+        p_nodes[i].row = 0; // Mark as shown, the real row follow below
+        p_nodes[i].parent = node.parent;
+        if (node.parent != -1) {
+            ++p_nodes[node.parent].childCount;
+        }
+        if (node.listed) {
+            p_listedNodes.append(i);
+        }
+    }
+
+    for (const int node : topLevelNodes) {
+        if (p_nodes.at(node).row < 0) {
+            continue;
+        }
+        p_nodes[node].row = p_children.size();
+        p_children.append(node);
+    }
+    p_topLevelCount = p_children.size();
+
+    int offset = p_topLevelCount;
+    for (Node &item : p_nodes) {
+        item.firstChild = offset;
+        offset += item.childCount;
+        item.childCount = 0; // Is counted again while filling
+    }
+    p_children.resize(offset);
+
+    for (int i = 0; i < p_nodes.size(); ++i) {
+        const int parentNode = p_nodes.at(i).parent;
+        if (p_nodes.at(i).row < 0 || parentNode == -1) {
+            continue;
+        }
+        Node &parent = p_nodes[parentNode];
+        p_children[parent.firstChild + parent.childCount] = i;
+        p_nodes[i].row = parent.childCount++;
+    }
+}
+
+
+void IndexModel::sortLayout()
+{
+    auto lessThan = [this](const int a, const int b) {
+        const int textA = p_nodes.at(a).textId;
+        const int textB = p_nodes.at(b).textId;
+        return textA != textB && p_texts.at(textA) < p_texts.at(textB);
+    };
+
+    // Each range is sorted on its own, like QTreeWidget does with its children
+    auto sortRange = [this, &lessThan](const int first, const int count) {
+        auto begin = p_children.begin() + first;
+        if (p_sortOrder == Qt::AscendingOrder) {
+            std::stable_sort(begin, begin + count, lessThan);
+        } else {
+            std::stable_sort(begin, begin + count, [&lessThan](const int a, const int b) { return lessThan(b, a); });
+        }
+        for (int row = 0; row < count; ++row) {
+            p_nodes[p_children.at(first + row)].row = row;
+        }
+    };
+
+    sortRange(0, p_topLevelCount);
+    for (int i = 0; i < p_nodes.size(); ++i) {
+        if (p_nodes.at(i).row > -1 && p_nodes.at(i).childCount > 1) {
+            sortRange(p_nodes.at(i).firstChild, p_nodes.at(i).childCount);
+        }
+    }
+}
+
+
+void IndexModel::buildPositionIndex()
+{
+    p_positions.clear();
+    p_childPositions.clear();
+
+    for (const int node : std::as_const(p_listedNodes)) {
+        if (p_nodes.at(node).line > -1) {
+            p_positions.append(node);
+        }
+    }
+
+    // The nodes are usually already in order, but detached ones like FIXME may not
+    std::stable_sort(p_positions.begin(), p_positions.end(), [this](const int a, const int b) {
+        const Node &nodeA = p_nodes.at(a);
+        const Node &nodeB = p_nodes.at(b);
+        return nodeA.line < nodeB.line || (nodeA.line == nodeB.line && nodeA.column < nodeB.column);
+    });
+
+    for (int i = 0; i < p_positions.size(); ++i) {
+        p_childPositions[p_nodes.at(p_positions.at(i)).parent].append(i);
+    }
+
+    // Each leaf hold the last line of a node, each other entry the max of its two children
+    p_endLineTreeSize = 1;
+    while (p_endLineTreeSize < p_positions.size()) {
+        p_endLineTreeSize *= 2;
+    }
+    p_endLineTree.fill(-1, 2 * p_endLineTreeSize);
+    for (int i = 0; i < p_positions.size(); ++i) {
+        const Node &node = p_nodes.at(p_positions.at(i));
+        // FIXME Some parser don't set the end line in some cases, as work around we use here begin line
+        p_endLineTree[p_endLineTreeSize + i] = qMax(node.line, node.endLine);
+    }
+    for (int i = p_endLineTreeSize - 1; i > 0; --i) {
+        p_endLineTree[i] = qMax(p_endLineTree.at(2 * i), p_endLineTree.at(2 * i + 1));
+    }
+}
+
+
+int IndexModel::positionsInFront(const int line, const int column) const
+{
+    auto it = std::upper_bound(p_positions.cbegin(), p_positions.cend(), qMakePair(line, column), [this](const QPair<int, int> &position, const int node) {
+        const Node &item = p_nodes.at(node);
+        return position.first < item.line || (position.first == item.line && position.second < item.column);
+    });
+
+    return it - p_positions.cbegin();
+}
+
+
+int IndexModel::lastPositionReaching(const int end, const int line) const
+{
+    // Collect the tree entries which cover the range [0, end) from right to left
+    QVarLengthArray<int, 64> ranges;
+    QVarLengthArray<int, 32> leftRanges;
+    for (int l = p_endLineTreeSize, r = end + p_endLineTreeSize; l < r; l >>= 1, r >>= 1) {
+        if (l & 1) {
+            leftRanges.append(l++);
+        }
+        if (r & 1) {
+            ranges.append(--r);
+        }
+    }
+    for (int i = leftRanges.size() - 1; i > -1; --i) {
+        ranges.append(leftRanges.at(i));
+    }
+
+    // Descend in the first range which reach the line, always on the right side when possible
+    for (int entry : ranges) {
+        if (p_endLineTree.at(entry) < line) {
+            continue;
+        }
+        while (entry < p_endLineTreeSize) {
+            entry = p_endLineTree.at(2 * entry + 1) < line ? 2 * entry : 2 * entry + 1;
+        }
+        return entry - p_endLineTreeSize;
+    }
+
+    return -1;
+}
+
+
+int IndexModel::lastChildPosition(const int parent, const int end) const
+{
+    auto it = p_childPositions.constFind(parent);
+    if (it == p_childPositions.constEnd()) {
+        return -1;
+    }
+
+    const QList<int> &positions = it.value();
+    auto behind = std::lower_bound(positions.cbegin(), positions.cend(), end);
+    return behind == positions.cbegin() ? -1 : *(behind - 1);
+}
+
+
+int IndexModel::nodeAt(const int line, const int column, bool &fuzzy) const
+{
+    fuzzy = false;
+
+    const int end = positionsInFront(line, column);
+    const int found = lastPositionReaching(end, line);
+    if (found < 0) {
+        return -1;
+    }
+
+    // We may be below the nested nodes of the found one, we want then the last of them
+    // but only if this is not some detached node like FIXME/TODO
+    const int node = p_positions.at(found);
+    const int fuzzyHit = qMax(lastChildPosition(node, end), lastChildPosition(p_nodes.at(node).parent, end));
+    if (fuzzyHit > found) {
+        fuzzy = true;
+        return p_positions.at(fuzzyHit);
+    }
+
+    return node;
+}
+
+
+int IndexModel::nodeBehind(const int line, const int column) const
+{
+    if (p_positions.isEmpty()) {
+        return -1;
+    }
+
+    const int end = positionsInFront(line, column);
+    return end < p_positions.size() ? p_positions.at(end) : p_positions.last();
+}
+
+
+QList<int> IndexModel::filteredNodes(const QString &pattern)
+{
+    if (p_foldedTexts.size() != p_texts.size()) {
+        p_foldedTexts.clear();
+        p_foldedTexts.reserve(p_texts.size());
+        for (const QString &text : std::as_const(p_texts)) {
+            p_foldedTexts.append(text.toCaseFolded());
+        }
+        p_filterPattern.clear();
+    }
+
+    const QString foldedPattern = pattern.toCaseFolded();
+
+    // Each text is checked only once, no matter how many nodes use it
+    QList<int> hits;
+    if (!p_filterPattern.isEmpty() && foldedPattern.contains(p_filterPattern)) {
+        // Can only match where the previous pattern has matched
+        for (const int textId : std::as_const(p_filterHits)) {
+            if (p_foldedTexts.at(textId).contains(foldedPattern)) {
+                hits.append(textId);
+            }
+        }
+    } else {
+        for (int textId = 0; textId < p_foldedTexts.size(); ++textId) {
+            if (p_foldedTexts.at(textId).contains(foldedPattern)) {
+                hits.append(textId);
+            }
+        }
+    }
+    p_filterPattern = foldedPattern;
+    p_filterHits = hits;
+
+    QList<bool> textIsHit(p_texts.size(), false);
+    for (const int textId : std::as_const(hits)) {
+        textIsHit[textId] = true;
+    }
+
+    QList<int> nodes;
+    for (const int node : std::as_const(p_listedNodes)) {
+        if (textIsHit.at(p_nodes.at(node).textId)) {
+            nodes.append(node);
+        }
+    }
+
+    return nodes;
+}
+
+
+QModelIndex IndexModel::indexOf(const int node) const
+{
+    if (node < 0 || node >= p_nodes.size() || p_nodes.at(node).row < 0) {
+        return QModelIndex();
+    }
+
+    return createIndex(p_nodes.at(node).row, 0, static_cast<quintptr>(node));
+}
+
+
+QModelIndex IndexModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (row < 0 || column != 0) {
+        return QModelIndex();
+    }
+
+    int first = 0;
+    int count = p_topLevelCount;
+    if (parent.isValid()) {
+        const Node &parentNode = p_nodes.at(nodeOf(parent));
+        first = parentNode.firstChild;
+        count = parentNode.childCount;
+    }
+
+    if (row >= count) {
+        return QModelIndex();
+    }
+
+    return createIndex(row, 0, static_cast<quintptr>(p_children.at(first + row)));
+}
+
+
+QModelIndex IndexModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return QModelIndex();
+    }
+
+    return indexOf(p_nodes.at(nodeOf(index)).parent);
+}
+
+
+int IndexModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) {
+        return p_topLevelCount;
+    }
+
+    if (parent.column() > 0) {
+        return 0;
+    }
+
+    return p_nodes.at(nodeOf(parent)).childCount;
+}
+
+
+int IndexModel::columnCount(const QModelIndex &/*parent*/) const
+{
+    return 1;
+}
+
+
+QVariant IndexModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    const Node &node = p_nodes.at(nodeOf(index));
+
+    switch (role) {
+        case Qt::DisplayRole:
+            return p_texts.at(node.textId);
+        case Qt::DecorationRole: {
+            auto it = p_icons.constFind(node.iconType);
+            if (it != p_icons.constEnd()) {
+                return it.value();
+            }
+            break;
+        }
+        case NodeData::Line:
+            return node.line;
+        case NodeData::Column:
+            return node.column;
+        case NodeData::EndLine:
+            return node.endLine;
+    }
+
+    return QVariant();
+}
+
+
+QVariant IndexModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (section != 0 || orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    return p_headerText;
+}
+
+
+Qt::ItemFlags IndexModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+
+void IndexModel::sort(int column, Qt::SortOrder order)
+{
+    if (column != 0) {
+        return;
+    }
+
+    Q_EMIT layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+    const QModelIndexList oldIndexes = persistentIndexList();
+
+    p_sorted = true;
+    p_sortOrder = order;
+    sortLayout();
+
+    QModelIndexList newIndexes;
+    newIndexes.reserve(oldIndexes.size());
+    for (const QModelIndex &index : oldIndexes) {
+        newIndexes.append(indexOf(nodeOf(index)));
+    }
+    changePersistentIndexList(oldIndexes, newIndexes);
+
+    Q_EMIT layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+// kate: space-indent on; indent-width 4; replace-tabs on;
@@ -0,0 +1,257 @@
+/*   This file is part of KatePlugin-IndexView
+ *
+ *   IndexModel Class
+ *   Copyright (C) 2018 loh.tar@googlemail.com
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Library General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Library General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef INDEXVIEW_INDEXMODEL_CLASS_H
+#define INDEXVIEW_INDEXMODEL_CLASS_H
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QIcon>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+
+enum NodeData {
+    Line = Qt::UserRole, // Where the pattern is located
+    Column,              // Where the pattern is located
+    EndLine              // Line number for which the item is still relevant/responsible
+};
+
+/**
+ * The @c IndexNode is the plain result of a parsing run, one entry for each node
+ * of the index tree. The nodes are held by @c Parser in a flat list and refer each
+ * other only by their position in that list, where a parent is always stored in
+ * front of its children. These can be created and modified outside of the GUI
+ * thread, the @c IndexModel is filled with them when all is done.
+ */
+struct IndexNode
+{
+    QString     text;
+    int         type = -1;
+    int         iconType = -1;  // The node type which icon is shown, not always the same as type
+    int         line = -1;      // Where the pattern is located
+    int         column = 0;     // Where the pattern is located
+    int         endLine = -1;   // Line number for which the node is still relevant/responsible
+    int         parent = -1;    // Position of the parent node or -1 for a top level node
+    bool        hidden = false;
+    bool        expanded = false;
+    bool        listed = false; // Is part of the index list
+};
+
+/**
+ * The @c IndexModel offer the result of a parsing run to the index tree view.
+ * Instead of one heavy item object for each node hold the model a contiguous
+ * array of a few integers per node, the texts are stored only once and the
+ * children of all nodes are kept in one list where each node own a range.
+ *
+ * A node is addressed by the same number it has in the @c IndexNode list of
+ * the parser. Hidden nodes are not part of the model, as well as all nodes which
+ * are not listed when the model is no tree.
+ *
+ * The model is not replaced after each parsing run but updated by updateNodes(),
+ * so that a view keep its expanded and selected rows and its scroll position.
+ *
+ * @author loh.tar
+ */
+class IndexModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    explicit IndexModel(QObject *parent = nullptr);
+   ~IndexModel();
+
+    /**
+     * Fill the model with the result of a parsing run, an old content is dropped.
+     * @param nodes the flat node list of the parser
+     * @param topLevelNodes the nodes without parent in order of appearance in the tree
+     * @param asTree when false, only the listed nodes are offered as plain list
+     */
+    void setNodes(const QList<IndexNode> &nodes, const QList<int> &topLevelNodes, bool asTree);
+
+    /**
+     * Bring the model up to date with the result of a new parsing run. Each shown node
+     * is matched with its old counterpart by its type, its text and the number of equal
+     * siblings in front of it below the same parent. When all rows are still at their
+     * place, only the changed rows are reported, typically the shifted line numbers
+     * below an edit. Otherwise is a layout change reported, where each kept row is
+     * moved to its new place and the others are inserted or removed.
+     * The parameters are the same as for setNodes()
+     * @return the shown nodes which had no counterpart
+     */
+    QList<int> updateNodes(const QList<IndexNode> &nodes, const QList<int> &topLevelNodes, bool asTree);
+
+    /**
+     * Set the icons to decorate the nodes, looked up by the icon type of a node.
+     * Set an empty hash to show no icons at all.
+     */
+    void setIcons(const QHash<int, QIcon> &icons) { p_icons = icons; };
+
+    /**
+     * Set the caption of the one and only column
+     */
+    void setHeaderText(const QString &text);
+
+    /**
+     * @return the listed nodes which are part of the model, in order of appearance
+     */
+    const QList<int> &listedNodes() const { return p_listedNodes; };
+
+    /**
+     * @return the node addressed by @p index or -1 when @p index is not valid
+     */
+    int nodeOf(const QModelIndex &index) const { return index.isValid() ? static_cast<int>(index.internalId()) : -1; };
+
+    /**
+     * @return the model index of @p node or an invalid one when @p node is not part of the model
+     */
+    QModelIndex indexOf(const int node) const;
+
+    /**
+     * Search the listed node which belongs to the document position @p line, @p column.
+     * That is the innermost node which begin in front of the position and end behind
+     * it, or begin in the same line. Should behind that node, but still in front of the
+     * position, follow a child or sibling of him, is the last of these taken as fuzzy hit.
+     * @param fuzzy is set to true when the hit is only fuzzy
+     * @return the found node or -1 when there is none
+     */
+    int nodeAt(const int line, const int column, bool &fuzzy) const;
+
+    /**
+     * @return the first listed node which begin behind @p line, @p column or the
+     * last one when there is none, -1 when there are no nodes at all
+     */
+    int nodeBehind(const int line, const int column) const;
+
+    /**
+     * Search the listed nodes which text contains @p pattern, case insensitive.
+     * The result is remembered until the model change, so when the next pattern
+     * contains the previous one, e.g. while typing, are only its hits checked again.
+     * @return the matching nodes in order of appearance
+     */
+    QList<int> filteredNodes(const QString &pattern);
+
+    QString text(const int node) const { return p_texts.at(p_nodes.at(node).textId); };
+    int line(const int node) const { return p_nodes.at(node).line; };
+    int column(const int node) const { return p_nodes.at(node).column; };
+    int endLine(const int node) const { return p_nodes.at(node).endLine; };
+    int parentNode(const int node) const { return p_nodes.at(node).parent; };
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+private:
+    struct Node
+    {
+        int     textId = 0;         // Position in p_texts
+        int     type = -1;
+        int     iconType = -1;
+        int     line = -1;
+        int     column = 0;
+        int     endLine = -1;
+        int     parent = -1;        // Parent in the model, -1 for a top level node
+        int     row = -1;           // Position below the parent, -1 when not part of the model
+        int     firstChild = 0;     // Start of the range in p_children
+        int     childCount = 0;
+    };
+
+    /**
+     * The whole content of the model, used to hold the old one aside while updating
+     */
+    struct Layout
+    {
+        QList<Node>         nodes;
+        QList<int>          children;
+        int                 topLevelCount = 0;
+        QStringList         texts;
+        QList<int>          listedNodes;
+    };
+
+    /**
+     * Exchange the content of the model with @p other, without any notification
+     */
+    void swapLayout(Layout &other);
+
+    /**
+     * Fill the model with @p nodes, without any notification. The parameters are the
+     * same as for setNodes()
+     */
+    void buildLayout(const QList<IndexNode> &nodes, const QList<int> &topLevelNodes, bool asTree);
+
+    /**
+     * Sort the children of each node according to @c p_sortOrder, without any notification
+     */
+    void sortLayout();
+
+    /**
+     * Fill the lookup tables of nodeAt() from the current content
+     */
+    void buildPositionIndex();
+
+    /**
+     * @return the number of nodes in @c p_positions which begin in front of or at @p line, @p column
+     */
+    int positionsInFront(const int line, const int column) const;
+
+    /**
+     * @return the last entry of @c p_positions in front of @p end where the node
+     * end at or behind @p line, or -1 when there is none
+     */
+    int lastPositionReaching(const int end, const int line) const;
+
+    /**
+     * @return the last entry of @c p_positions in front of @p end which is a child of @p parent,
+     * or -1 when there is none
+     */
+    int lastChildPosition(const int parent, const int end) const;
+
+    QList<Node>                     p_nodes;
+    QList<int>                      p_children;     // The top level range first, then all others
+    int                             p_topLevelCount = 0;
+    QStringList                     p_texts;
+    QList<int>                      p_listedNodes;
+    QHash<int, QIcon>               p_icons;
+    QString                         p_headerText;
+    bool                            p_sorted = false;   // Set by sort(), so that updates are sorted too
+    Qt::SortOrder                   p_sortOrder = Qt::AscendingOrder;
+
+    // The lookup tables of nodeAt()
+    QList<int>                      p_positions;        // Listed nodes with a line, ordered by line and column
+    QList<int>                      p_endLineTree;      // Max end line of each range of p_positions, a binary tree as array
+    int                             p_endLineTreeSize = 1;
+    QHash<int, QList<int>>          p_childPositions;   // The entries of p_positions by parent node
+
+    // The state of filteredNodes(), reset by buildLayout()
+    QStringList                     p_foldedTexts;      // p_texts in case folded variant, filled on demand
+    QString                         p_filterPattern;    // Case folded
+    QList<int>                      p_filterHits;       // The matching entries of p_texts
+};
+
+#endif
+
+// kate: space-indent on; indent-width 4; replace-tabs on;
@@ -26,8 +26,10 @@
 #include <QEvent>
 #include <QHeaderView>
 #include <QKeyEvent>
+#include <QSet>
 #include <QToolButton>
 #include <QStackedWidget>
+#include <QTreeWidget>
 #include <QVBoxLayout>
 
 #include <KConfigGroup>
@@ -46,6 +48,8 @@
 #include "index_view.h"
 
 #define UpdateCurrItemDelay 400 // Sensible compromise, determined by try&error
+#define MinParseDelay 50        // Even small files should not be parsed on each key stroke
+#define ParseCostFactor 4       // Parse delay compared to the last parse cost
 
 IndexView::IndexView(KatePluginIndexView *plugin, KTextEditor::MainWindow *mw)
     : QObject(mw)
@@ -122,10 +126,10 @@ IndexView::IndexView(KatePluginIndexView *plugin, KTextEditor::MainWindow *mw)
 
     // Ensure we don't keep stuff for gone docs
     connect(KTextEditor::Editor::instance()->application(), &KTextEditor::Application::documentWillBeDeleted, this, [this](KTextEditor::Document *doc) {
+        m_plugin->m_lookupIndex.removeDocument(doc);
         auto parser = m_cache.take(doc);
         if (parser) {
-            m_treeStack->removeWidget(parser->indexTree());
-            delete parser;
+            releaseParser(parser);
         }
         if (m_cache.isEmpty()) {
             m_treeStack->setCurrentWidget(m_welcomeTree);
@@ -143,8 +147,7 @@ IndexView::~IndexView()
     m_mainWindow->guiFactory()->removeClient(this);
 
     for (auto parser : m_cache) {
-        m_treeStack->removeWidget(parser->indexTree());
-        delete parser;
+        releaseParser(parser);
     }
 
     delete m_toolview;
@@ -190,6 +193,7 @@ void IndexView::loadViewSettings()
     KConfigGroup mainGroup(KSharedConfig::openConfig(), QStringLiteral("PluginIndexView"));
     m_cozyClickExpand = mainGroup.readEntry(QStringLiteral("CozyClickExpand"), false);
     m_parseDelay = mainGroup.readEntry(QStringLiteral("ParseDelay"), 1000);
+    m_commentTags = mainGroup.readEntry(QStringLiteral("CommentTags"), QStringList());
 }
 
 
@@ -198,6 +202,7 @@ void IndexView::saveViewSettings()
     KConfigGroup mainGroup(KSharedConfig::openConfig(), QStringLiteral("PluginIndexView"));
     mainGroup.writeEntry(QStringLiteral("CozyClickExpand"), m_cozyClickExpand);
     mainGroup.writeEntry(QStringLiteral("ParseDelay"), m_parseDelay);
+    mainGroup.writeEntry(QStringLiteral("CommentTags"), m_commentTags);
 }
 
 
@@ -242,7 +247,7 @@ void IndexView::viewChanged()
         m_parseDelayTimer.start(10);
     } else {
         filterTree();
-        m_treeStack->setCurrentWidget(parser->indexTree());
+        m_treeStack->setCurrentWidget(indexTree(parser));
     }
 }
 
@@ -269,8 +274,7 @@ void IndexView::docModeChanged(KTextEditor::Document *doc)
         }
 
         m_cache.remove(doc);
-        m_treeStack->removeWidget(parser->indexTree());
-        delete parser;
+        releaseParser(parser);
     }
 
     KTextEditor::View *docView = m_mainWindow->activeView();
@@ -283,12 +287,15 @@ void IndexView::docModeChanged(KTextEditor::Document *doc)
         return;
     }
 
-    parser = Parser::create(doc, newDocType, this);
-    parser->loadSettings();
+    parser = m_plugin->acquireParser(doc, newDocType);
 
-    m_treeStack->addWidget(parser->indexTree());
+    auto indexTree = parser->addIndexTree();
+    connect(indexTree, &QTreeView::clicked, this, &IndexView::itemClicked);
+    connect(indexTree, &QTreeView::customContextMenuRequested, this, &IndexView::showContextMenu);
+    m_treeStack->addWidget(indexTree);
 
     m_cache.insert(doc, parser);
+    m_indexTrees.insert(parser, indexTree);
 
     connect(docView, &KTextEditor::View::cursorPositionChanged, this, &IndexView::docCursorPositionChanged, Qt::UniqueConnection);
     connect(docView, &KTextEditor::View::selectionChanged, this, &IndexView::docSelectionChanged, Qt::UniqueConnection);
@@ -297,6 +304,12 @@ void IndexView::docModeChanged(KTextEditor::Document *doc)
     connect(doc, &KTextEditor::Document::textChanged, this, &IndexView::docEdited);
     connect(parser, &Parser::parsingDone, this, &IndexView::parsingDone);
 
+    if (!parser->needsUpdate() && !parser->isParsing()) {
+        // Some other window has already done the job
+        parsingDone(parser);
+        return;
+    }
+
     // Don't call parseDocument() direct, must wait a little until other stuff is done
     m_parseDelayTimer.start(10);
 }
@@ -326,7 +339,19 @@ void IndexView::docEdited(KTextEditor::Document *doc)
     }
 
     m_updateCurrItemDelayTimer.stop(); // Avoid unneeded update
-    m_parseDelayTimer.start(m_parseDelay);
+    m_parseDelayTimer.start(parseDelay(parser));
+}
+
+
+int IndexView::parseDelay(Parser *parser) const
+{
+    if (!parser || parser->parseCost() < 0) {
+        return m_parseDelay;
+    }
+
+    // Small files are done fast and can follow the typing, big ones are only parsed
+    // as often as it is worth it, but never later than configured
+    return qBound<qint64>(MinParseDelay, parser->parseCost() * ParseCostFactor, m_parseDelay);
 }
 
 
@@ -351,7 +376,9 @@ void IndexView::docCursorPositionChanged()
         return;
     }
 
-    m_updateCurrItemDelayTimer.start(UpdateCurrItemDelay);
+    // The lookup is fast, but the tree view should not follow each single step
+    // while an arrow key is hold down
+    m_updateCurrItemDelayTimer.start(10);
 }
 
 
@@ -390,34 +417,26 @@ void IndexView::lookupIndex()
 
     m_lookupTree->clear();
     QTreeWidgetItem *docNode = nullptr;
-
-    // Iterate over all our parser (aka open/used documents)...
-    for (auto i = m_cache.cbegin(), end = m_cache.cend(); i != end; ++i) {
-        // ...but skip the current one...
-        if (i.value() == parser) {
-            continue;
+    KTextEditor::Document *doc = nullptr;
+
+    // Search in the index list of all parsed documents, but not in the current one
+    const QList<LookupIndex::Hit> hits = m_plugin->m_lookupIndex.lookup(pattern, parser->document());
+    for (const LookupIndex::Hit &hit : hits) {
+        if (hit.document != doc) {
+            doc = hit.document;
+            docNode = new QTreeWidgetItem(m_lookupTree);
+            docNode->setText(0, doc->documentName());
+            docNode->setExpanded(true);
+            docNode->setIcon(0, QIcon::fromTheme(QStringLiteral("text-x-generic")));
         }
 
-        // ...and search in their index list
-        for (const auto item : std::as_const(*i.value()->indexList())) {
-            if (!item->text(0).contains(pattern, Qt::CaseSensitive)) {
-                continue;
-            }
-
-            if (!docNode) {
-                docNode = new QTreeWidgetItem(m_lookupTree);
-                docNode->setText(0, i.key()->documentName());
-                docNode->setExpanded(true);
-                docNode->setIcon(0, QIcon::fromTheme(QStringLiteral("text-x-generic")));
-            }
-
-            QTreeWidgetItem *node = item->clone();
-            // Storing a pointer in a QVariant need a special treatment
-            node->setData(0, NodeData::EndLine, QVariant::fromValue<KTextEditor::Document*>(i.value()->document()));
-            docNode->addChild(node);
-        }
-
-        docNode = nullptr;
+        auto node = new QTreeWidgetItem(docNode);
+        node->setText(0, hit.text);
+        node->setIcon(0, hit.icon);
+        node->setData(0, NodeData::Line, hit.line);
+        node->setData(0, NodeData::Column, hit.column);
+        // Storing a pointer in a QVariant need a special treatment
+        node->setData(0, NodeData::EndLine, QVariant::fromValue<KTextEditor::Document*>(hit.document));
     }
 
     if (m_lookupTree->topLevelItemCount() < 1) {
@@ -474,8 +493,8 @@ void IndexView::filterTree()
     auto docView = m_mainWindow->activeView();
 
     // To filter our tree is surprising complex because there seams to be no
-    // suitable Qt build in for that. QTreeWidget::findItems() does not traverse
-    // and delivers only toplevel matches
+    // suitable Qt build in for that. QSortFilterProxyModel would hide the parents
+    // of a match, so we hide the rows of the view by ourself
 
     // Only pattern without space and at least three char long
     static const QRegularExpression rx(QStringLiteral("^\\S{3,}$"));
@@ -492,16 +511,10 @@ void IndexView::filterTree()
         return;
     }
 
-    // Test if something match...
-    bool hit = false;
-    for (QTreeWidgetItem *item : std::as_const(*parser->indexList())) {
-        if (item->text(0).contains(pattern, Qt::CaseInsensitive)) {
-            hit = true;
-            break;
-        }
-    }
+    IndexModel *model = parser->indexModel();
+    const QList<int> hits = model->filteredNodes(pattern);
 
-    if (!hit) {
+    if (hits.isEmpty()) {
         m_updateCurrItemDelayTimer.start(10);
         restoreTree(parser);
         m_filterBox->indicateMatch(FilterBox::NoMatch);
@@ -509,20 +522,32 @@ void IndexView::filterTree()
     }
 
     m_filterBox->indicateMatch(FilterBox::Match);
-    parser->setTreeFiltered(true);
-    auto indexTree = parser->indexTree();
-    for (QTreeWidgetItem *item : std::as_const(*parser->indexList())) {
-        if (item->text(0).contains(pattern, Qt::CaseInsensitive)) {
-            while (item) {
-                indexTree->expandItem(item);
-                item->setHidden(false);
-                item = item->parent();
-            }
-        } else {
-            item->setHidden(true);
+    auto indexTree = this->indexTree(parser);
+    m_filteredTrees.insert(indexTree);
+
+    // Change all rows at once, not one after another with a new layout each time
+    indexTree->setUpdatesEnabled(false);
+
+    for (const int node : model->listedNodes()) {
+        const QModelIndex index = model->indexOf(node);
+        indexTree->setRowHidden(index.row(), index.parent(), true);
+    }
+
+    // Parents are shared by many hits, so each is only once shown and expanded
+    QSet<int> shownNodes;
+    for (const int node : hits) {
+        int currNode = node;
+        while (currNode > -1 && !shownNodes.contains(currNode)) {
+            shownNodes.insert(currNode);
+            const QModelIndex index = model->indexOf(currNode);
+            indexTree->setRowHidden(index.row(), index.parent(), false);
+            indexTree->expand(index);
+            currNode = model->parentNode(currNode);
         }
     }
 
+    indexTree->setUpdatesEnabled(true);
+
     m_updateCurrItemDelayTimer.start(10);
 }
 
@@ -535,29 +560,30 @@ void IndexView::restoreTree(Parser *parser)
 
     m_filterBox->indicateMatch(FilterBox::Neutral);
 
-    if (!parser->treeIsFiltered()) {
+    auto indexTree = this->indexTree(parser);
+    if (!m_filteredTrees.remove(indexTree)) {
         m_updateCurrItemDelayTimer.start(10);
         return;
     }
 
-    parser->setTreeFiltered(false);
-    auto indexTree = parser->indexTree();
+    const IndexModel *model = parser->indexModel();
 
     if (parser->showAsTree()) {
-        for (int i = 0; i < indexTree->topLevelItemCount(); i++) {
-            indexTree->topLevelItem(i)->setExpanded(parser->showExpanded());
+        for (int i = 0; i < model->rowCount(); i++) {
+            indexTree->setExpanded(model->index(i, 0), parser->showExpanded());
         }
     }
 
-    for (QTreeWidgetItem *item : std::as_const(*parser->indexList())) {
-        item->setHidden(false);
-        item->setExpanded(parser->showExpanded());
+    for (const int node : model->listedNodes()) {
+        const QModelIndex index = model->indexOf(node);
+        indexTree->setRowHidden(index.row(), index.parent(), false);
+        indexTree->setExpanded(index, parser->showExpanded());
     }
 
-    QTreeWidgetItem *node = indexTree->currentItem();
-    while (node) {
-        indexTree->expandItem(node);
-        node = node->parent();
+    QModelIndex index = indexTree->currentIndex();
+    while (index.isValid()) {
+        indexTree->expand(index);
+        index = index.parent();
     }
 
     m_updateCurrItemDelayTimer.start(10);
@@ -582,68 +608,37 @@ void IndexView::updateCurrTreeItem()
         return;
     }
 
-    auto indexTree = parser->indexTree();
+    auto indexTree = this->indexTree(parser);
     m_treeStack->setCurrentWidget(indexTree);
 
+    const IndexModel *model = parser->indexModel();
     KTextEditor::Cursor cursorPos = docView->cursorPositionVirtual();
-    QTreeWidgetItem *currItem = indexTree->currentItem();
-    if (currItem) {
-        if (currItem->data(0, NodeData::Line).toInt() == cursorPos.line() && currItem->data(0, NodeData::Column).toInt() <= cursorPos.column()) {
-            indexTree->scrollToItem(currItem);
+    int currNode = model->nodeOf(indexTree->currentIndex());
+    if (currNode > -1) {
+        if (model->line(currNode) == cursorPos.line() && model->column(currNode) <= cursorPos.column()) {
+            indexTree->scrollTo(indexTree->currentIndex());
             return;
         }
     }
 
-    bool newItemIsFuzzy = true;
-    QTreeWidgetItem *newItem = nullptr;
-    for (int i = 0; i < parser->indexList()->size(); ++i) {
-        currItem = parser->indexList()->at(i);
-        const int beginLine = currItem->data(0, NodeData::Line).toInt();
-        const int beginColumn = currItem->data(0, NodeData::Column).toInt();
-        // FIXME Some parser don't set the end line in some cases, as work around we use here begin line
-        //qDebug() << currItem->data(0, NodeData::EndLine).toInt() << currItem->text(0);
-        const int endLine   = currItem->data(0, NodeData::EndLine).toInt() < 0 ? beginLine : currItem->data(0, NodeData::EndLine).toInt();
-
-        if (beginLine < 0) {
-            // Ignore (bad) root items
-            continue;
-        }
-
-        if (beginLine > cursorPos.line() || (cursorPos.line() == beginLine && cursorPos.column() < beginColumn) ) {
-            // We are already below the cursor
-            break;
-        }
-
-        if (cursorPos.line() == beginLine && cursorPos.column() >= beginColumn) {
-            // We are just inside a candidate
-            newItem = currItem;
-            newItemIsFuzzy = false;
-        } else if (endLine >= cursorPos.line() && beginLine < cursorPos.line()) {
-            // We are inside a candidate
-            newItem = currItem;
-            newItemIsFuzzy = false;
-        } else if (newItem && (currItem->parent() == newItem->parent() || currItem->parent() == newItem)) {
-            // We are in a nested situation, we want the last one above the cursor but only
-            // if this is not some detached node like FIXME/TODO
-            newItem = currItem;
-            newItemIsFuzzy = true;
-        }
-    }
+    bool newNodeIsFuzzy = true;
+    const int newNode = model->nodeAt(cursorPos.line(), cursorPos.column(), newNodeIsFuzzy);
 
-    if (currItem == indexTree->currentItem() && newItemIsFuzzy) {
+    const int oldNode = model->nodeOf(indexTree->currentIndex());
+    if (newNodeIsFuzzy && model->nodeBehind(cursorPos.line(), cursorPos.column()) == oldNode) {
         // The situation is fuzzy, any change make nothing better
-        indexTree->scrollToItem(indexTree->currentItem());
+        indexTree->scrollTo(indexTree->currentIndex());
         return;
     }
 
-    if (newItem && newItem != indexTree->currentItem()) {
-        //qDebug() << "set new item from" << newItem->data(0, NodeData::Line).toInt() << "to" << newItem->data(0, NodeData::EndLine).toInt();
+    if (newNode > -1 && newNode != oldNode) {
+        //qDebug() << "set new item from" << model->line(newNode) << "to" << model->endLine(newNode);
         indexTree->blockSignals(true);
-        indexTree->setCurrentItem(newItem);
+        indexTree->setCurrentIndex(model->indexOf(newNode));
         indexTree->blockSignals(false);
     }
 
-    indexTree->scrollToItem(indexTree->currentItem());
+    indexTree->scrollTo(indexTree->currentIndex());
 }
 
 
@@ -689,33 +684,27 @@ void IndexView::parseDocument()
         return;
     }
 
-    if (parser->isParsing()) {
-        // Parse is already running, do it later
-        docEdited(parser->document());
-        return;
-    }
-
     if (!parser->needsUpdate()) {
         return;
     }
 
-    // The ultimate-special-final-director-cut flicker-avoidance :-/ Part A
-    m_treeStack->setUpdatesEnabled(false);
-
+    // A running parse is outdated and about to give up, the parser start the new one right after it
     parser->parse();
 }
 
 
-void IndexView::parsingDone(Parser *parser)
+void IndexView::releaseParser(Parser *parser)
 {
-    auto indexTree = parser->indexTree();
-    connect(indexTree, &QTreeWidget::itemClicked, this, &IndexView::itemClicked);
-    connect(indexTree, &QTreeWidget::customContextMenuRequested, this, &IndexView::showContextMenu);
+    auto indexTree = m_indexTrees.take(parser);
+    m_filteredTrees.remove(indexTree);
+    m_treeStack->removeWidget(indexTree);
+    parser->removeIndexTree(indexTree);
+    m_plugin->releaseParser(parser);
+}
 
-    m_treeStack->addWidget(indexTree);
-    m_treeStack->removeWidget(parser->mustyTree());
-    parser->burnDownMustyTree();
 
+void IndexView::parsingDone(Parser *parser)
+{
     if (parser != parserOfCurrentView()) {
         // View/Doc has changed in the meanwhile
         return;
@@ -726,31 +715,31 @@ void IndexView::parsingDone(Parser *parser)
     m_updateCurrItemDelayTimer.stop(); // Started in filterTree(), but we don't need/want that now
     updateCurrTreeItem();
 
-    // All updates are done, switch to the new tree now
-    m_treeStack->setCurrentWidget(indexTree);
+    m_treeStack->setCurrentWidget(indexTree(parser));
 
-    // The ultimate-special-final-director-cut flicker-avoidance :-/ Part B
-    // Why 300 is needed, who knows? 200 works almost but not full
-    QTimer::singleShot(300, this, [this]() {
-        m_treeStack->setUpdatesEnabled(true);
-    });
+    if (parser->needsUpdate()) {
+        // The document was edited while the worker thread was busy
+        m_parseDelayTimer.start(10);
+    }
 }
 
 
-void IndexView::itemClicked(QTreeWidgetItem *it)
+void IndexView::itemClicked(const QModelIndex &index)
 {
-    if (!it) {
+    if (!index.isValid()) {
         return;
     }
 
-    int line   = it->data(0, NodeData::Line).toInt();
-    int column = it->data(0, NodeData::Column).toInt();
+    int line   = index.data(NodeData::Line).toInt();
+    int column = index.data(NodeData::Column).toInt();
 
     if (m_cozyClickExpand) {
-        if (m_lastClickedItem == it) {
-            it->setExpanded(!it->isExpanded());
+        auto parser = parserOfCurrentView();
+        if (parser && m_lastClickedIndex == index) {
+            auto indexTree = this->indexTree(parser);
+            indexTree->setExpanded(index, !indexTree->isExpanded(index));
         }
-        m_lastClickedItem = it;
+        m_lastClickedIndex = index;
     }
 
     KTextEditor::View *docView = m_mainWindow->activeView();
@@ -27,6 +27,7 @@
 #ifndef INDEX_VIEW_H
 #define INDEX_VIEW_H
 
+#include <QPersistentModelIndex>
 #include <QPointer>
 #include <QTimer>
 class QStackedWidget;
@@ -77,7 +78,7 @@ public Q_SLOTS:
     void showContextMenu(const QPoint&);
     void parseDocument();
     void parsingDone(Parser *parser);
-    void itemClicked(QTreeWidgetItem *it);
+    void itemClicked(const QModelIndex &index);
     void lookupItemClicked(QTreeWidgetItem *it);
 
 protected:
@@ -88,10 +89,15 @@ private:
     int             filterBoxPosition();
     void            updateFilterBoxPosition(int pos);
     void            restoreTree(Parser *parser);
+    void            releaseParser(Parser *parser);
+    int             parseDelay(Parser *parser) const;
+    QTreeView      *indexTree(Parser *parser) const { return m_indexTrees.value(parser); };
 
     KatePluginIndexView        *m_plugin;
     KTextEditor::MainWindow    *m_mainWindow;
-    QHash<KTextEditor::Document*, Parser*> m_cache;
+    QHash<KTextEditor::Document*, Parser*> m_cache;     // Shared with other windows, see KatePluginIndexView::acquireParser
+    QHash<Parser*, QTreeView*>  m_indexTrees;           // Our own view of each parser
+    QSet<QTreeView*>            m_filteredTrees;
 
     QWidget                    *m_toolview;
     QStackedWidget             *m_treeStack;
@@ -106,9 +112,10 @@ private:
     FilterBox                  *m_filterBox;
     QTimer                      m_filterDelayTimer;
 
-    QTreeWidgetItem            *m_lastClickedItem = nullptr;
+    QPersistentModelIndex       m_lastClickedIndex;
     bool                        m_cozyClickExpand;
     int                         m_parseDelay;
+    QStringList                 m_commentTags;  // Used by each new created parser
 
 };
 
@@ -0,0 +1,437 @@
+/*   This file is part of KatePlugin-IndexView
+ *
+ *   indexview-cli, run the parsers without Kate
+ *   Copyright (C) 2025 loh.tar@googlemail.com
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Library General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Library General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QUrl>
+
+#include <KTextEditor/Document>
+#include <KTextEditor/Editor>
+
+#include "parser.h"
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+
+/**
+ * Load @p fileName as KTextEditor document without any view. The document
+ * type is the same as in Kate, unless a @p docType is given.
+ * @return nullptr when the file could not be read
+ */
+static KTextEditor::Document *openDocument(const QString &fileName, QString &docType)
+{
+    KTextEditor::Document *doc = KTextEditor::Editor::instance()->createDocument(nullptr);
+    if (!doc->openUrl(QUrl::fromLocalFile(QFileInfo(fileName).absoluteFilePath()))) {
+        delete doc;
+        return nullptr;
+    }
+
+    if (docType.isEmpty()) {
+        // Same as IndexView::docModeChanged()
+        docType = doc->highlightingMode();
+        if (QLatin1String("None") == docType) {
+            docType = doc->mode();
+        }
+    }
+
+    return doc;
+}
+
+
+/**
+ * Run a full parsing of the document of @p parser and wait until it is done
+ */
+static void parseDocument(Parser *parser)
+{
+    QEventLoop loop;
+    QObject::connect(parser, &Parser::parsingDone, &loop, &QEventLoop::quit);
+
+    parser->docNeedParsing();
+    parser->parse();
+    if (parser->isParsing()) {
+        loop.exec();
+    }
+}
+
+
+/**
+ * Write the listed nodes of the last parsing run of @p parser as JSON object
+ */
+static QJsonObject nodesToJson(Parser *parser)
+{
+    const IndexModel *model = parser->indexModel();
+    const QList<int> &listedNodes = model->listedNodes();
+
+    // The parent is given as position in the JSON list, or -1 when not listed
+    QHash<int, int> positions;
+    for (int i = 0; i < listedNodes.size(); ++i) {
+        positions.insert(listedNodes.at(i), i);
+    }
+
+    QJsonArray nodes;
+    for (const int node : listedNodes) {
+        QJsonObject jsonNode;
+        jsonNode.insert(QStringLiteral("text"), model->text(node));
+        jsonNode.insert(QStringLiteral("line"), model->line(node));
+        jsonNode.insert(QStringLiteral("column"), model->column(node));
+        jsonNode.insert(QStringLiteral("endLine"), model->endLine(node));
+        jsonNode.insert(QStringLiteral("parent"), positions.value(model->parentNode(node), -1));
+        nodes.append(jsonNode);
+    }
+
+    QJsonObject result;
+    result.insert(QStringLiteral("file"), parser->document()->url().toLocalFile());
+    result.insert(QStringLiteral("type"), parser->docType());
+    result.insert(QStringLiteral("parser"), QLatin1String(parser->metaObject()->className()));
+    result.insert(QStringLiteral("nodes"), nodes);
+
+    return result;
+}
+
+
+/**
+ * Build a large text of @p lineCount lines by repeating the lines of @p text
+ */
+static QString scaledText(const QString &text, const int lineCount)
+{
+    const QStringList lines = text.split(QLatin1Char('\n'));
+    QStringList result;
+    result.reserve(lineCount);
+    while (result.size() < lineCount) {
+        result.append(lines.mid(0, lineCount - result.size()));
+    }
+
+    return result.join(QLatin1Char('\n'));
+}
+
+
+/**
+ * Unlike the peak usage, this goes down again when memory is freed, so the growth
+ * over a parsing run tell what the parser keep of it
+ * @return the current memory usage of this process in KiB or -1 when unknown
+ */
+static long residentMemory()
+{
+#ifdef Q_OS_LINUX
+    // The second field is the resident set size in pages
+    QFile file(QStringLiteral("/proc/self/statm"));
+    if (file.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> fields = file.readAll().split(' ');
+        bool ok = false;
+        const long pages = fields.value(1).toLong(&ok);
+        if (ok) {
+            return pages * (sysconf(_SC_PAGESIZE) / 1024);
+        }
+    }
+#endif
+    return -1;
+}
+
+
+/**
+ * Parse the document @p fileName scaled to each of the @p lineCounts and print
+ * how fast that was
+ * @return false when the file could not be read
+ */
+static bool runBenchmark(const QString &fileName, QString docType, const QList<int> &lineCounts, QTextStream &out)
+{
+    KTextEditor::Document *doc = openDocument(fileName, docType);
+    if (!doc) {
+        return false;
+    }
+
+    const QString text = doc->text();
+    for (const int lineCount : lineCounts) {
+        doc->setText(scaledText(text, lineCount));
+
+        // A fresh parser each time, so that it's always a full parsing run
+        const long memoryBefore = residentMemory();
+        Parser *parser = Parser::create(doc, docType, nullptr);
+        parser->loadSettings();
+
+        QElapsedTimer timer;
+        timer.start();
+        parseDocument(parser);
+        const qint64 msecs = qMax<qint64>(1, timer.elapsed());
+        const qsizetype nodeCount = parser->indexModel()->listedNodes().size();
+        const long memoryAfter = residentMemory();
+
+        out << qSetFieldWidth(24) << Qt::left << QFileInfo(fileName).fileName()
+            << qSetFieldWidth(18) << parser->metaObject()->className()
+            << qSetFieldWidth(10) << Qt::right << lineCount
+            << qSetFieldWidth(8) << nodeCount
+            << qSetFieldWidth(8) << msecs
+            << qSetFieldWidth(12) << lineCount * 1000 / msecs
+            << qSetFieldWidth(10) << nodeCount * 1000 / msecs
+            << qSetFieldWidth(10) << (memoryBefore < 0 || memoryAfter < 0 ? -1 : memoryAfter - memoryBefore)
+            << qSetFieldWidth(0) << Qt::endl;
+
+        delete parser;
+    }
+
+    delete doc;
+
+    return true;
+}
+
+
+/**
+ * Parse @p doc from scratch with a fresh parser of @p docType
+ * @return the listed nodes
+ */
+static QJsonArray parseFromScratch(KTextEditor::Document *doc, const QString &docType, bool chunkRuns)
+{
+    Parser *parser = Parser::create(doc, docType, nullptr);
+    parser->loadSettings();
+    parser->setChunkRunsEnabled(chunkRuns);
+    parseDocument(parser);
+    const QJsonArray nodes = nodesToJson(parser).value(QStringLiteral("nodes")).toArray();
+    delete parser;
+
+    return nodes;
+}
+
+
+/**
+ * Compare the listed nodes of @p parser with the @p expected ones and print the
+ * first difference, if any
+ * @return true when both are the same
+ */
+static bool sameNodes(Parser *parser, const QJsonArray &expected, const QString &what, QTextStream &err)
+{
+    const QJsonArray nodes = nodesToJson(parser).value(QStringLiteral("nodes")).toArray();
+    if (nodes == expected) {
+        return true;
+    }
+
+    err << "MISMATCH " << what << ": " << nodes.size() << " nodes instead of " << expected.size() << Qt::endl;
+    for (int i = 0; i < qMax(nodes.size(), expected.size()); ++i) {
+        const QJsonObject node = i < nodes.size() ? nodes.at(i).toObject() : QJsonObject();
+        const QJsonObject expectedNode = i < expected.size() ? expected.at(i).toObject() : QJsonObject();
+        if (node != expectedNode) {
+            err << "  node " << i << " is   " << QJsonDocument(node).toJson(QJsonDocument::Compact) << Qt::endl;
+            err << "  node " << i << " must " << QJsonDocument(expectedNode).toJson(QJsonDocument::Compact) << Qt::endl;
+            break;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * Parse the document @p fileName from scratch, split into chunks and resumed after
+ * a synthetic edit, and compare the results. A small document is also scaled up
+ * so that it is split into chunks.
+ * @return the count of mismatches, or -1 when the file could not be read
+ */
+static int runVerify(const QString &fileName, QString docType, QTextStream &out, QTextStream &err)
+{
+    KTextEditor::Document *file = openDocument(fileName, docType);
+    if (!file) {
+        return -1;
+    }
+
+    QStringList texts = {file->text()};
+    if (file->lines() < 2 * Chunk_MinSize) {
+        texts.append(scaledText(texts.first(), 3 * Chunk_MinSize));
+    }
+    delete file;
+
+    // Without an URL is no result cache used and no report written
+    KTextEditor::Document *doc = KTextEditor::Editor::instance()->createDocument(nullptr);
+    int mismatches = 0;
+
+    for (const QString &text : std::as_const(texts)) {
+        doc->setText(text);
+        const QString what = QStringLiteral("%1 with %2 lines").arg(QFileInfo(fileName).fileName()).arg(doc->lines());
+
+        const QJsonArray expected = parseFromScratch(doc, docType, false);
+
+        Parser *parser = Parser::create(doc, docType, nullptr);
+        parser->loadSettings();
+        parseDocument(parser);
+        const int chunks = parser->chunksTakenOver();
+        bool ok = sameNodes(parser, expected, what + QStringLiteral(", split into chunks"), err);
+
+        // A line is inserted in the middle and removed again, each time resume the parser
+        const int line = doc->lines() / 2;
+        doc->insertText(KTextEditor::Cursor(line, 0), QStringLiteral("\n"));
+        parseDocument(parser);
+        bool resumed = parser->lastRunResumed();
+        ok = sameNodes(parser, parseFromScratch(doc, docType, false), what + QStringLiteral(", resumed after insert"), err) && ok;
+
+        doc->removeText(KTextEditor::Range(line, 0, line + 1, 0));
+        parseDocument(parser);
+        resumed = resumed && parser->lastRunResumed();
+        ok = sameNodes(parser, expected, what + QStringLiteral(", resumed after remove"), err) && ok;
+
+        out << qSetFieldWidth(24) << Qt::left << QFileInfo(fileName).fileName()
+            << qSetFieldWidth(18) << parser->metaObject()->className()
+            << qSetFieldWidth(10) << Qt::right << doc->lines()
+            << qSetFieldWidth(8) << expected.size()
+            << qSetFieldWidth(8) << chunks
+            << qSetFieldWidth(10) << (resumed ? "yes" : "no")
+            << qSetFieldWidth(10) << (ok ? "ok" : "MISMATCH")
+            << qSetFieldWidth(0) << Qt::endl;
+
+        delete parser;
+        if (!ok) {
+            ++mismatches;
+        }
+    }
+
+    delete doc;
+
+    return mismatches;
+}
+
+
+int main(int argc, char *argv[])
+{
+    // The parsers keep their result in a tree widget, but nobody need to see them
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    QApplication::setApplicationName(QStringLiteral("indexview-cli"));
+
+    QCommandLineParser cmdLine;
+    cmdLine.setApplicationDescription(QStringLiteral("Print the index of files as the Kate plugin Index View would show it"));
+    cmdLine.addHelpOption();
+    cmdLine.addPositionalArgument(QStringLiteral("files"), QStringLiteral("The files to index"), QStringLiteral("files..."));
+    const QCommandLineOption jsonOption(QStringLiteral("json"), QStringLiteral("Print the nodes as JSON instead of a Status Report"));
+    cmdLine.addOption(jsonOption);
+    const QCommandLineOption typeOption(QStringLiteral("type"), QStringLiteral("Use the parser for <type>, e.g. \"C++\", instead of the detected one"), QStringLiteral("type"));
+    cmdLine.addOption(typeOption);
+    const QCommandLineOption benchmarkOption(QStringLiteral("benchmark"), QStringLiteral("Parse each file repeated to the comma separated line counts and print the speed"), QStringLiteral("lines"));
+    cmdLine.addOption(benchmarkOption);
+    const QCommandLineOption verifyOption(QStringLiteral("verify"), QStringLiteral("Check that a full, a resumed and a chunk split parsing give the same nodes"));
+    cmdLine.addOption(verifyOption);
+    cmdLine.process(app);
+
+    const QStringList fileNames = cmdLine.positionalArguments();
+    if (fileNames.isEmpty()) {
+        cmdLine.showHelp(1);
+    }
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QJsonArray jsonFiles;
+    int exitCode = 0;
+
+    if (cmdLine.isSet(benchmarkOption)) {
+        QList<int> lineCounts;
+        for (const QString &value : cmdLine.value(benchmarkOption).split(QLatin1Char(','))) {
+            const int lineCount = value.toInt();
+            if (lineCount > 0) {
+                lineCounts.append(lineCount);
+            }
+        }
+
+        out << qSetFieldWidth(24) << Qt::left << "File"
+            << qSetFieldWidth(18) << "Parser"
+            << qSetFieldWidth(10) << Qt::right << "Lines"
+            << qSetFieldWidth(8) << "Nodes"
+            << qSetFieldWidth(8) << "ms"
+            << qSetFieldWidth(12) << "Lines/s"
+            << qSetFieldWidth(10) << "Nodes/s"
+            << qSetFieldWidth(10) << "Grown KiB"
+            << qSetFieldWidth(0) << Qt::endl;
+
+        for (const QString &fileName : fileNames) {
+            if (!runBenchmark(fileName, cmdLine.value(typeOption), lineCounts, out)) {
+                err << "FATAL: Can't read " << fileName << Qt::endl;
+                exitCode = 1;
+            }
+        }
+
+        return exitCode;
+    }
+
+    if (cmdLine.isSet(verifyOption)) {
+        out << qSetFieldWidth(24) << Qt::left << "File"
+            << qSetFieldWidth(18) << "Parser"
+            << qSetFieldWidth(10) << Qt::right << "Lines"
+            << qSetFieldWidth(8) << "Nodes"
+            << qSetFieldWidth(8) << "Chunks"
+            << qSetFieldWidth(10) << "Resumed"
+            << qSetFieldWidth(10) << "Result"
+            << qSetFieldWidth(0) << Qt::endl;
+
+        for (const QString &fileName : fileNames) {
+            const int mismatches = runVerify(fileName, cmdLine.value(typeOption), out, err);
+            if (mismatches < 0) {
+                err << "FATAL: Can't read " << fileName << Qt::endl;
+            }
+            if (mismatches != 0) {
+                exitCode = 1;
+            }
+        }
+
+        return exitCode;
+    }
+
+    for (const QString &fileName : fileNames) {
+        QString docType = cmdLine.value(typeOption);
+        KTextEditor::Document *doc = openDocument(fileName, docType);
+        if (!doc) {
+            err << "FATAL: Can't read " << fileName << Qt::endl;
+            exitCode = 1;
+            continue;
+        }
+
+        Parser *parser = Parser::create(doc, docType, nullptr);
+        parser->loadSettings();
+        parser->setResultCacheEnabled(false);
+        parseDocument(parser);
+
+        if (cmdLine.isSet(jsonOption)) {
+            jsonFiles.append(nodesToJson(parser));
+        } else {
+            parser->writeReport(out);
+            out << Qt::endl;
+        }
+
+        delete parser;
+        delete doc;
+    }
+
+    if (cmdLine.isSet(jsonOption)) {
+        out << QJsonDocument(jsonFiles).toJson();
+    }
+
+    return exitCode;
+}
+
+// kate: space-indent on; indent-width 4; replace-tabs on;
@@ -52,6 +52,7 @@ KatePluginIndexViewConfigPage::KatePluginIndexViewConfigPage(KatePluginIndexView
     connect(ui_cozyClickExpand, &QCheckBox::toggled, this, &KatePluginIndexViewConfigPage::changed);
     // QSpinBox::valueChanged need special treatment, Qt docu is not clear to me, so thanks to https://forum.qt.io/post/345501
     connect(ui_parseDelay, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &KatePluginIndexViewConfigPage::changed);
+    connect(ui_commentTags, &QLineEdit::textChanged, this, &KatePluginIndexViewConfigPage::changed);
 }
 
 
@@ -98,6 +99,11 @@ KatePluginIndexView::KatePluginIndexView(QObject *parent, const QList<QVariant>&
 
 KatePluginIndexView::~KatePluginIndexView()
 {
+    // Should be none left, the views release their parsers when they go
+    for (auto it = m_parserUsers.constBegin(); it != m_parserUsers.constEnd(); ++it) {
+        it.key()->waitForParsing();
+        delete it.key();
+    }
 }
 
 
@@ -123,6 +129,45 @@ QObject *KatePluginIndexView::createView(KTextEditor::MainWindow *mainWindow)
 }
 
 
+Parser *KatePluginIndexView::acquireParser(KTextEditor::Document *doc, const QString &docType)
+{
+    Parser *parser = m_parsers.value(doc);
+    if (parser && parser->docType() == docType) {
+        ++m_parserUsers[parser];
+        return parser;
+    }
+
+    // An old parser of some other type is still in use until all views have noticed the change
+    parser = Parser::create(doc, docType, this);
+    parser->loadSettings();
+    connect(parser, &Parser::parsingDone, this, [this](Parser *parser) {
+        m_lookupIndex.updateDocument(parser->document(), parser->indexModel());
+    });
+
+    m_parsers.insert(doc, parser);
+    m_parserUsers.insert(parser, 1);
+
+    return parser;
+}
+
+
+void KatePluginIndexView::releaseParser(Parser *parser)
+{
+    if (--m_parserUsers[parser] > 0) {
+        return;
+    }
+
+    m_parserUsers.remove(parser);
+    if (m_parsers.value(parser->document()) == parser) {
+        m_parsers.remove(parser->document());
+    }
+
+    // The parser may be busy in its worker thread, which still use its members
+    parser->waitForParsing();
+    delete parser;
+}
+
+
 KTextEditor::ConfigPage *KatePluginIndexView::configPage(int number, QWidget *parent)
 {
     if (number != 0) {
@@ -142,6 +187,7 @@ KTextEditor::ConfigPage *KatePluginIndexView::configPage(int number, QWidget *pa
             p->ui_filterBoxOnTop->setChecked(view->filterBoxPosition() == 2);
             p->ui_cozyClickExpand->setChecked(view->m_cozyClickExpand);
             p->ui_parseDelay->setValue(view->m_parseDelay);
+            p->ui_commentTags->setText(view->m_commentTags.join(QStringLiteral(", ")));
         }
 
         for (auto parser : view->m_cache) {
@@ -199,6 +245,12 @@ void KatePluginIndexView::applyConfig(KatePluginIndexViewConfigPage *p)
 
         view->m_cozyClickExpand = p->ui_cozyClickExpand->isChecked();
         view->m_parseDelay = p->ui_parseDelay->value();
+        view->m_commentTags.clear();
+        for (const QString &tag : p->ui_commentTags->text().split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+            if (!tag.trimmed().isEmpty()) {
+                view->m_commentTags << tag.trimmed();
+            }
+        }
 
         if (!saved) {
             // No need to save for each view
@@ -27,12 +27,14 @@
 #ifndef KATE_PLUGIN_INDEX_VIEW_H
 #define KATE_PLUGIN_INDEX_VIEW_H
 
+#include <QHash>
 #include <QSet>
 
 #include <KLocalizedString>
 #include <KTextEditor/ConfigPage>
 #include <KTextEditor/Plugin>
 
+#include "lookup_index.h"
 #include "ui_kate_plugin_index_view_config_page.h"
 #include "ui_kate_plugin_index_view_config_page_about_parser.h"
 
@@ -86,6 +88,11 @@ public:
 };
 
 class IndexView;
+class Parser;
+
+namespace KTextEditor {
+class Document;
+}
 
 class KatePluginIndexView : public KTextEditor::Plugin
 {
@@ -111,7 +118,22 @@ public Q_SLOTS:
     void applyConfig(KatePluginIndexViewConfigPage *p);
 
 private:
+    /**
+     * All main windows share the parser of a document, so that it is only once parsed.
+     * Each call must be paired with releaseParser().
+     * @return the parser of @p doc for @p docType, which is created when needed
+     */
+    Parser *acquireParser(KTextEditor::Document *doc, const QString &docType);
+
+    /**
+     * Give up one use of @p parser, which is deleted when nobody use it anymore
+     */
+    void releaseParser(Parser *parser);
+
     QSet<IndexView *> m_views;
+    LookupIndex       m_lookupIndex;    // Shared by all views, so that each document is only once noted
+    QHash<KTextEditor::Document *, Parser *> m_parsers;  // The current one of each document
+    QHash<Parser *, int>                     m_parserUsers;
 
 };
 
@@ -0,0 +1,173 @@
+/*   This file is part of KatePlugin-IndexView
+ *
+ *   LookupIndex Class
+ *   Copyright (C) 2025 loh.tar@googlemail.com
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Library General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Library General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include <algorithm>
+
+#include <QSet>
+
+#include "index_model.h"
+
+#include "lookup_index.h"
+
+
+LookupIndex::LookupIndex()
+{
+}
+
+
+LookupIndex::~LookupIndex()
+{
+}
+
+
+void LookupIndex::updateDocument(KTextEditor::Document *document, const IndexModel *model)
+{
+    removeDocument(document);
+
+    QList<int> &entries = p_documentEntries[document];
+    for (const int node : model->listedNodes()) {
+        Hit entry;
+        entry.document = document;
+        entry.text = model->text(node);
+        entry.icon = model->data(model->indexOf(node), Qt::DecorationRole).value<QIcon>();
+        entry.line = model->line(node);
+        entry.column = model->column(node);
+
+        const int id = p_entries.size();
+        for (const quint64 trigram : trigrams(entry.text)) {
+            p_postings[trigram].append(id);
+        }
+        p_entries.append(entry);
+        entries.append(id);
+    }
+}
+
+
+void LookupIndex::removeDocument(KTextEditor::Document *document)
+{
+    const QList<int> entries = p_documentEntries.take(document);
+    for (const int id : entries) {
+        p_entries[id] = Hit();
+    }
+    p_goneEntries += entries.size();
+
+    // Gone entries are skipped by lookup(), but should not pile up
+    if (p_goneEntries > 1000 && p_goneEntries > p_entries.size() / 2) {
+        compact();
+    }
+}
+
+
+QList<LookupIndex::Hit> LookupIndex::lookup(const QString &pattern, const KTextEditor::Document *skipDocument) const
+{
+    // Start with the rarest trigram, each further one can only shrink the candidates
+    QList<const QList<int> *> postings;
+    for (const quint64 trigram : trigrams(pattern)) {
+        auto it = p_postings.constFind(trigram);
+        if (it == p_postings.constEnd()) {
+            return QList<Hit>();
+        }
+        postings.append(&it.value());
+    }
+    if (postings.isEmpty()) {
+        return QList<Hit>();
+    }
+    std::sort(postings.begin(), postings.end(), [](const QList<int> *a, const QList<int> *b) {
+        return a->size() < b->size();
+    });
+
+    QList<int> candidates = *postings.first();
+    for (int i = 1; i < postings.size() && !candidates.isEmpty(); ++i) {
+        const QList<int> &posting = *postings.at(i);
+        candidates.removeIf([&posting](const int id) {
+            return !std::binary_search(posting.cbegin(), posting.cend(), id);
+        });
+    }
+
+    // The trigrams may be in the text but not in a row
+    QList<QPair<int, int>> rankedIds;
+    for (const int id : std::as_const(candidates)) {
+        const Hit &entry = p_entries.at(id);
+        if (!entry.document || entry.document == skipDocument || !entry.text.contains(pattern)) {
+            continue;
+        }
+        const int rank = entry.text == pattern ? 0 : entry.text.startsWith(pattern) ? 1 : 2;
+        rankedIds.append(qMakePair(rank, id));
+    }
+    std::stable_sort(rankedIds.begin(), rankedIds.end(), [](const QPair<int, int> &a, const QPair<int, int> &b) {
+        return a.first < b.first;
+    });
+
+    // Keep the hits of a document together, the documents in order of their best hit
+    QList<const KTextEditor::Document *> documents;
+    QHash<const KTextEditor::Document *, QList<int>> idsByDocument;
+    for (const auto &rankedId : std::as_const(rankedIds)) {
+        const KTextEditor::Document *document = p_entries.at(rankedId.second).document;
+        if (!idsByDocument.contains(document)) {
+            documents.append(document);
+        }
+        idsByDocument[document].append(rankedId.second);
+    }
+
+    QList<Hit> hits;
+    hits.reserve(rankedIds.size());
+    for (const KTextEditor::Document *document : std::as_const(documents)) {
+        for (const int id : idsByDocument.value(document)) {
+            hits.append(p_entries.at(id));
+        }
+    }
+
+    return hits;
+}
+
+
+QList<quint64> LookupIndex::trigrams(const QString &text)
+{
+    QSet<quint64> trigrams;
+    for (int i = 0; i + 2 < text.size(); ++i) {
+        trigrams.insert(quint64(text.at(i).unicode()) << 32 | quint64(text.at(i + 1).unicode()) << 16 | text.at(i + 2).unicode());
+    }
+
+    return trigrams.values();
+}
+
+
+void LookupIndex::compact()
+{
+    const QList<Hit> entries = p_entries;
+    p_entries.clear();
+    p_postings.clear();
+    p_goneEntries = 0;
+
+    for (auto it = p_documentEntries.begin(); it != p_documentEntries.end(); ++it) {
+        QList<int> &ids = it.value();
+        for (int &id : ids) {
+            const Hit &entry = entries.at(id);
+            id = p_entries.size();
+            for (const quint64 trigram : trigrams(entry.text)) {
+                p_postings[trigram].append(id);
+            }
+            p_entries.append(entry);
+        }
+    }
+}
+
+// kate: space-indent on; indent-width 4; replace-tabs on;
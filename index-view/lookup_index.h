@@ -0,0 +1,100 @@
+/*   This file is part of KatePlugin-IndexView
+ *
+ *   LookupIndex Class
+ *   Copyright (C) 2025 loh.tar@googlemail.com
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Library General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Library General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef INDEXVIEW_LOOKUPINDEX_CLASS_H
+#define INDEXVIEW_LOOKUPINDEX_CLASS_H
+
+#include <QHash>
+#include <QIcon>
+#include <QList>
+#include <QString>
+
+namespace KTextEditor {
+class Document;
+}
+
+class IndexModel;
+
+/**
+ * The @c LookupIndex hold the listed nodes of all parsed documents, to find fast
+ * where some selected text is defined in other documents. Each text is split into
+ * all its sequences of three chars, the trigrams, and for each trigram is noted
+ * which node texts contain it. A lookup has then only to check the nodes which
+ * contain all trigrams of the pattern.
+ *
+ * @author loh.tar
+ */
+class LookupIndex
+{
+
+public:
+    struct Hit
+    {
+        KTextEditor::Document  *document = nullptr;
+        QString                 text;
+        QIcon                   icon;
+        int                     line = -1;
+        int                     column = 0;
+    };
+
+    LookupIndex();
+   ~LookupIndex();
+
+    /**
+     * Replace the entries of @p document by the listed nodes of @p model
+     */
+    void updateDocument(KTextEditor::Document *document, const IndexModel *model);
+
+    /**
+     * Drop all entries of @p document
+     */
+    void removeDocument(KTextEditor::Document *document);
+
+    /**
+     * Search all nodes which text contains @p pattern, case sensitive. The hits are
+     * ranked, nodes which are named like the pattern first, then these which start
+     * with the pattern, then the others. The hits of a document follow each other.
+     * @param pattern must be at least three char long
+     * @param skipDocument whose nodes are not of interest
+     * @return the ranked hits
+     */
+    QList<Hit> lookup(const QString &pattern, const KTextEditor::Document *skipDocument) const;
+
+private:
+    /**
+     * @return each trigram of @p text only once, as key for @c p_postings
+     */
+    static QList<quint64> trigrams(const QString &text);
+
+    /**
+     * Drop the entries of removed documents, which are still noted in @c p_postings
+     */
+    void compact();
+
+    QList<Hit>                                          p_entries;          // Gone ones have no document
+    QHash<quint64, QList<int>>                          p_postings;         // The entries by trigram, ascending
+    QHash<const KTextEditor::Document *, QList<int>>    p_documentEntries;
+    int                                                 p_goneEntries = 0;
+};
+
+#endif
+
+// kate: space-indent on; indent-width 4; replace-tabs on;
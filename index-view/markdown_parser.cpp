@@ -49,6 +49,37 @@ MarkdownParser::~MarkdownParser()
 }
 
 
+void MarkdownParser::prepareForParse()
+{
+    initHistory(3);
+    m_blockEnd.clear();
+
+    if (p_detachLinks->isChecked()) {
+        m_detachedNodeTypes << LinkNode;
+    } else {
+        m_detachedNodeTypes.remove(LinkNode);
+    }
+
+    DocumentParser::prepareForParse();
+}
+
+
+void MarkdownParser::saveScanState(ScanState &state) const
+{
+    DocumentParser::saveScanState(state);
+
+    state.addText(m_blockEnd);
+}
+
+
+void MarkdownParser::restoreScanState(ScanState &state)
+{
+    DocumentParser::restoreScanState(state);
+
+    m_blockEnd = state.takeText();
+}
+
+
 // MarkdownParser is massive based on PlainTextParser
 // The main differences are:
 //   Enhanced LineType enum
@@ -57,7 +88,7 @@ MarkdownParser::~MarkdownParser()
 //   Removed quirk for ISO headers
 //   Removed #~^ as header underlining
 
-void MarkdownParser::parseDocument()
+int MarkdownParser::classifyLine(QStringView line) const
 {
     static const QRegularExpression rxEqualLine(QStringLiteral(R"(^[=]{3,}$)"));
     static const QRegularExpression rxDashLine(QStringLiteral(R"(^[-]{3,}$)"));
@@ -66,49 +97,47 @@ void MarkdownParser::parseDocument()
     static const QRegularExpression rxCodeLine(QStringLiteral(R"(^(\t| {4,})+\S.*$)"));
     static const QRegularExpression rxIndentLine(QStringLiteral(R"(^( {2,})+\S.*$)"));
 
-    QString paraLine;   // First line of a paragraph
-    initHistory(3);
-
-    if (p_detachLinks->isChecked()) {
-        m_detachedNodeTypes << LinkNode;
-    } else {
-        m_detachedNodeTypes.remove(LinkNode);
+    if (line.contains(rxDashLine)) {
+        return DashLine;
+    } else if (line.contains(rxEqualLine)) {
+        return EqualLine;
+    } else if (line.contains(rxHeader)) {
+        return HeaderLine;
+    } else if (line.contains(rxLinkLine)) {
+        return LinkLine;
+    } else if (line.contains(rxCodeLine)) {
+        // More is not needed to ignore code lines "by Gruber", just this notice
+        return CodeLine;
+
+        // Due to the similarity with rxCodeLine we must check after CodeLine
+        // HINT: Looks pointless, a modified version of rxCodeLine should do it too
+        // but who knows what we can further improve...
+    } else if (line.contains(rxIndentLine)) {
+        // More is not needed to ignore indent lines, just this notice
+        return IndentLine;
     }
 
+    return NormalLine;
+}
+
+
+void MarkdownParser::parseDocument()
+{
+    classifyLines();
+
     while (nextLine()) {
-        // Let's start the investigation
-        bool currIsEqualLine = rawLine().contains(rxEqualLine);
-        bool currIsDashLine  = rawLine().contains(rxDashLine);
-        bool currIsHeader    = rawLine().contains(rxHeader);
-        bool currIsLink      = rawLine().contains(rxLinkLine);
-        bool currIsCode      = rawLine().contains(rxCodeLine);
-        bool currIsIndented  = rawLine().contains(rxIndentLine);
-
-        // Keep a record of the history
-        if (m_line.isEmpty()) {
-            addToHistory(EmptyLine, m_line);
-        } else if (currIsDashLine) {
-            addToHistory(DashLine, m_line);
-        } else if (currIsEqualLine) {
-            addToHistory(EqualLine, m_line);
-        } else if (currIsHeader) {
-            addToHistory(HeaderLine, m_line);
-        } else if (currIsLink) {
-            addToHistory(LinkLine, m_line);
-        } else if (currIsCode) {
-            // More is not needed to ignore code lines "by Gruber", just this notice
-            addToHistory(CodeLine, m_line);
-
-            // Due to the similarity with rxCodeLine we must check after currIsCode
-            // HINT: Looks pointless, a modified version of rxCodeLine should do it too
-            // but who knows what we can further improve...
-        } else if (currIsIndented) {
-            // More is not needed to ignore indent lines, just this notice
-            addToHistory(IndentLine, m_line);
-        } else {
-            addToHistory(NormalLine, m_line);
+        // Skip all lines of a code or pre block
+        if (!m_blockEnd.isEmpty()) {
+            if (rawLine().startsWith(m_blockEnd)) {
+                m_blockEnd.clear();
+                initHistory();
+            }
+            continue;
         }
 
+        // Keep a record of the history, the investigation was done by classifyLine()
+        addToHistory(m_line.isEmpty() ? EmptyLine : lineType(), m_line);
+
         // Waste some memory to increase readability
         const int line0Type = m_lineTypeHistory.at(0); // Oldest line
         const int line1Type = m_lineTypeHistory.at(1);
@@ -117,10 +146,10 @@ void MarkdownParser::parseDocument()
         // Check for Paragraph begin
         if (m_paraLineNumber < 0) {
             if (line1Type == NormalLine) {
-                paraLine = m_lineHistory.at(1);
+                m_paraLine = m_lineHistory.at(1);
                 m_paraLineNumber = lineNumber() - 1;
             } else if (line2Type == NormalLine) {
-                paraLine = m_lineHistory.at(2);
+                m_paraLine = m_lineHistory.at(2);
                 m_paraLineNumber = lineNumber();
             }
         }
@@ -130,26 +159,26 @@ void MarkdownParser::parseDocument()
             continue;
 
         } else if (line2Type  == LinkLine) {
-            if (p_detachLinks->isChecked()) {
+            if (optionIsChecked(p_detachLinks)) {
                 addDetachedNode(LinkNode, m_line, lineNumber());
             } else {
-                QTreeWidgetItem *parentNode = lastNode();
-                while (parentNode) {
-                    if (parentNode->type() <= Head6Node) {
+                int parentNode = lastNode();
+                while (parentNode != NoNode) {
+                    if (nodeTypeOf(parentNode) <= Head6Node) {
                         break;
                     }
-                    parentNode = parentNode->parent();
+                    parentNode = nodeParent(parentNode);
                 }
                 addNodeToParent(LinkNode, parentNode, m_line);
             }
 
             // Check for Paragraph - Single line
         } else if (line0Type != NormalLine && line1Type == NormalLine  && line2Type  == EmptyLine) {
-            addNode(ParaNode, paraLine, m_paraLineNumber);
+            addNode(ParaNode, m_paraLine, m_paraLineNumber);
 
             // Check for Paragraph - Two or more lines
         } else if (line0Type == NormalLine && line1Type == NormalLine  && line2Type != NormalLine) {
-            addNode(ParaNode, paraLine, m_paraLineNumber);
+            addNode(ParaNode, m_paraLine, m_paraLineNumber);
 
             // Check for Setext-style header H2
         } else if (line0Type != NormalLine && line1Type == NormalLine && line2Type == DashLine) {
@@ -177,23 +206,11 @@ void MarkdownParser::parseDocument()
 
             // Check for github code blocks to be skipped
         } else if (rawLine().startsWith(QStringLiteral("```"))) {
-            while (nextLine()) {
-                if (!rawLine().startsWith(QStringLiteral("```"))) {
-                    continue;
-                }
-                initHistory();
-                break;
-            }
+            m_blockEnd = QStringLiteral("```");
 
             // Check for pre blocks to be skipped
         } else if (rawLine().startsWith(QStringLiteral("<pre>"))) {
-            while (nextLine()) {
-                if (!rawLine().startsWith(QStringLiteral("</pre>"))) {
-                    continue;
-                }
-                initHistory();
-                break;
-            }
+            m_blockEnd = QStringLiteral("</pre>");
         }
     }
 
@@ -221,6 +238,14 @@ AsciiDocParser::~AsciiDocParser()
 }
 
 
+void AsciiDocParser::prepareForParse()
+{
+    initHistory(3);
+
+    DocumentParser::prepareForParse();
+}
+
+
 // AsciiDocParser is massive based on MarkdownParser
 // The main differences are:
 //   Removed Setext-style header
@@ -231,33 +256,31 @@ AsciiDocParser::~AsciiDocParser()
 //       But I understood this more as a "we try to be handy feature" and not be part of
 //       the AsciiDoc spec, so I think we should not support these too
 
-void AsciiDocParser::parseDocument()
+int AsciiDocParser::classifyLine(QStringView line) const
 {
     static const QRegularExpression rxEqualLine(QStringLiteral(R"(^[=]{3,}$)"));
     static const QRegularExpression rxDashLine(QStringLiteral(R"(^[-]{3,}$)"));
     static const QRegularExpression rxHeader(QStringLiteral(R"(^={1,6}\s.*$)"));
 
-    QString paraLine;   // First line of a paragraph
-    initHistory(3);
+    if (line.contains(rxDashLine)) {
+        return DashLine;
+    } else if (line.contains(rxEqualLine)) { // atm not used (and related)
+        return EqualLine;
+    } else if (line.contains(rxHeader)) {
+        return HeaderLine;
+    }
+
+    return NormalLine;
+}
+
+
+void AsciiDocParser::parseDocument()
+{
+    classifyLines();
 
     while (nextLine()) {
-        // Let's start the investigation
-        bool currIsEqualLine = rawLine().contains(rxEqualLine);// atm not used (and related)
-        bool currIsDashLine  = rawLine().contains(rxDashLine);
-        bool currIsHeader    = rawLine().contains(rxHeader);
-
-        // Keep a record of the history
-        if (m_line.isEmpty()) {
-            addToHistory(EmptyLine, m_line);
-        } else if (currIsDashLine) {
-            addToHistory(DashLine, m_line);
-        } else if (currIsEqualLine) {
-            addToHistory(EqualLine, m_line);
-        } else if (currIsHeader) {
-            addToHistory(HeaderLine, m_line);
-        } else {
-            addToHistory(NormalLine, m_line);
-        }
+        // Keep a record of the history, the investigation was done by classifyLine()
+        addToHistory(m_line.isEmpty() ? EmptyLine : lineType(), m_line);
 
         // Waste some memory to increase readability
         const int line0Type = m_lineTypeHistory.at(0); // Oldest line
@@ -267,10 +290,10 @@ void AsciiDocParser::parseDocument()
         // Check for Paragraph begin
         if (m_paraLineNumber < 0) {
             if (line1Type == NormalLine) {
-                paraLine = m_lineHistory.at(1);
+                m_paraLine = m_lineHistory.at(1);
                 m_paraLineNumber = lineNumber() - 1;
             } else if (line2Type == NormalLine) {
-                paraLine = m_lineHistory.at(2);
+                m_paraLine = m_lineHistory.at(2);
                 m_paraLineNumber = lineNumber();
             } else if (line2Type != HeaderLine) {
                 continue;
@@ -283,11 +306,11 @@ void AsciiDocParser::parseDocument()
 
             // Check for Paragraph - Single line
         } else if (line0Type != NormalLine && line1Type == NormalLine  && line2Type  == EmptyLine) {
-            addNode(ParaNode, paraLine, m_paraLineNumber);
+            addNode(ParaNode, m_paraLine, m_paraLineNumber);
 
             // Check for Paragraph - Two or more lines
         } else if (line0Type == NormalLine && line1Type == NormalLine  && line2Type != NormalLine) {
-            addNode(ParaNode, paraLine, m_paraLineNumber);
+            addNode(ParaNode, m_paraLine, m_paraLineNumber);
 
             // Check for sharp # header
         } else if (line2Type == HeaderLine) {
@@ -64,9 +64,14 @@ protected:
     QString version() override { return QStringLiteral("0.9, Jul 2025"); } ;
     QString author() override { return QStringLiteral("2018, 2022, 2025 loh.tar"); } ;
 
+    void prepareForParse() override;
+    void saveScanState(ScanState &state) const override;
+    void restoreScanState(ScanState &state) override;
+    int classifyLine(QStringView line) const override;
     void parseDocument() override;
 
     QAction *p_detachLinks;
+    QString  m_blockEnd;    // The begin of the line which close a skipped block
 };
 
 /**
@@ -105,6 +110,8 @@ protected:
     QString version() override { return QStringLiteral("0.5, Aug 2022"); } ;
     QString author() override { return QStringLiteral("2022 loh.tar"); } ;
 
+    void prepareForParse() override;
+    int classifyLine(QStringView line) const override;
     void parseDocument() override;
 
 };
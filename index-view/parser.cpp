@@ -19,10 +19,18 @@
  */
 
 
-#include <QApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QHeaderView>
-#include <QScrollBar>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
 
 #include <KConfigGroup>
 #include <KLocalizedString>
@@ -68,25 +76,22 @@ DummyParser::~DummyParser()
 
 void DummyParser::addNode(const int nodeType, const QString &text)
 {
-    QTreeWidgetItem *node = new QTreeWidgetItem(p_indexTree, nodeType);
+    const int node = newNode(NoNode, nodeType);
 
-    // Don't fill p_usefulOptions, so option will hidden
-    // QAction *viewOption = p_viewOptions.value(nodeType, nullptr);
-    // p_usefulOptions.insert(viewOption);
+    // Don't fill p_usefulNodeTypes, so option will hidden
+    // p_usefulNodeTypes.insert(nodeType);
 
-    if (node) {
-        node->setText(0, text);
-        // Don't set icon, looks odd
-        // node->setIcon(0, p_nodeTypes.value(nodeType).icon);
-        node->setData(0, NodeData::Column, -1);
-        node->setData(0, NodeData::Line, -1);
-    }
+    p_nodes[node].text = text;
+    // Don't set icon, looks odd
+    // p_nodes[node].iconType = nodeType;
+    p_nodes[node].column = -1;
+    p_nodes[node].line = -1;
 }
 
 
 void DummyParser::parseDocument()
 {
-    p_indexTree->setRootIsDecorated(0);
+    setRootIsDecorated(false);
     addNode(InfoNode, i18n("Sorry, not supported yet!"));
     addNode(InfoNode, i18n("File type: %1", docType()));
 }
@@ -95,7 +100,7 @@ void DummyParser::parseDocument()
 Parser::Parser(QObject *view, KTextEditor::Document *doc)
     : QObject(view)
     , p_document(doc)
-    , p_indexTree(new QTreeWidget())
+    , p_indexModel(new IndexModel(this))
 {
     p_viewSort     = addViewOption(QStringLiteral("SortIndex"), i18n("Show Sorted"));
     p_viewTree     = addViewOption(QStringLiteral("TreeView"), i18n("Tree View"));
@@ -110,14 +115,51 @@ Parser::Parser(QObject *view, KTextEditor::Document *doc)
     m_detachedNodeTypes << GitConflictNode;
 
     p_modifierOptions.append(DependencyPair(p_viewExpanded, p_viewTree));
+
+    connect(&p_parseWatcher, &QFutureWatcher<void>::finished, this, &Parser::finishParse);
+
+    // A chunk parser, see startChunkRuns(), is owned by its master and parse only its snapshot
+    p_chunkMaster = qobject_cast<Parser *>(view);
+    if (p_chunkMaster) {
+        return;
+    }
+
+    // Keep track of the edited lines, so we may not need to parse the whole document again.
+    // Some edits may reported twice, e.g. as textInserted and lineWrapped, but that's no harm
+    connect(doc, &KTextEditor::Document::textInserted, this, [this](KTextEditor::Document *, KTextEditor::Cursor position, const QString &text) {
+        markLinesEdited(position.line(), position.line() + text.count(QLatin1Char('\n')));
+    });
+    connect(doc, &KTextEditor::Document::textRemoved, this, [this](KTextEditor::Document *, KTextEditor::Range range, const QString &) {
+        markLinesEdited(range.start().line(), range.start().line());
+    });
+    connect(doc, &KTextEditor::Document::lineWrapped, this, [this](KTextEditor::Document *, KTextEditor::Cursor position) {
+        markLinesEdited(position.line(), position.line() + 1);
+    });
+    connect(doc, &KTextEditor::Document::lineUnwrapped, this, [this](KTextEditor::Document *, int line) {
+        markLinesEdited(qMax(0, line - 1), qMax(0, line - 1));
+    });
+    connect(doc, &KTextEditor::Document::reloaded, this, [this]() {
+        p_fullParseNeeded = true;
+    });
 }
 
 
 Parser::~Parser()
 {
+    waitForParsing();
+
     saveSettings();
 
-    delete p_indexTree;
+    qDeleteAll(p_indexTrees);
+}
+
+
+void Parser::waitForParsing()
+{
+    p_parseWatcher.waitForFinished();
+
+    // Usually joined by the worker, but our chunk parsers must not run any longer than we do
+    waitForChunkRuns();
 }
 
 
@@ -205,13 +247,13 @@ void Parser::loadSettings()
         action->blockSignals(true);
         if (action->objectName() == QStringLiteral("SortIndex")) {
             // SortIndex setting need sadly a lot of special treatment
-            if (config.readEntry(action->objectName(), false)) {
-                action->setChecked(true);
-                indexTree()->setSortingEnabled(true);
-                indexTree()->sortItems(0, static_cast<Qt::SortOrder>(config.readEntry(QStringLiteral("SortIndexOrder"), 0/*Qt::AscendingOrder*/)));
-            } else {
-                action->setChecked(false);
-                indexTree()->setSortingEnabled(false);
+            p_sortOrder = static_cast<Qt::SortOrder>(config.readEntry(QStringLiteral("SortIndexOrder"), 0/*Qt::AscendingOrder*/));
+            action->setChecked(config.readEntry(action->objectName(), false));
+            for (QTreeView *indexTree : std::as_const(p_indexTrees)) {
+                indexTree->setSortingEnabled(action->isChecked());
+                if (action->isChecked()) {
+                    indexTree->sortByColumn(0, p_sortOrder);
+                }
             }
         } else {
             action->setChecked(config.readEntry(action->objectName(), true));
@@ -239,64 +281,163 @@ void Parser::saveSettings()
     }
 
     // SortIndex setting need special treatment
-    config.writeEntry(QStringLiteral("SortIndexOrder"), static_cast<int>(indexTree()->header()->sortIndicatorOrder()));
+    config.writeEntry(QStringLiteral("SortIndexOrder"), static_cast<int>(sortOrder()));
 }
 
 
 void Parser::prepareForParse()
 {
-    p_indexTree->setRootIsDecorated(p_viewTree->isChecked());
+    setRootIsDecorated(p_viewTree->isChecked());
 }
 
 
-QTreeWidgetItem *Parser::addDetachedNode(int nodeType, const QString &text, const int lineNumber, const int columnNumber/* = 0*/)
+int Parser::addDetachedNode(int nodeType, const QString &text, const int lineNumber, const int columnNumber/* = 0*/)
 {
     if (!m_detachedNodeTypes.contains(nodeType) || !nodeTypeIsWanted(nodeType)) {
-        return nullptr;
+        return NoNode;
     }
 
-    auto node = new QTreeWidgetItem(rootNode(nodeType), nodeType);
+    const int node = newNode(rootNode(nodeType), nodeType);
     setNodeProperties(node, nodeType, text, lineNumber, columnNumber);
 
     return node;
 }
 
 
-QTreeWidgetItem *Parser::rootNode(int nodeType)
+int Parser::rootNode(int nodeType)
 {
-    QTreeWidgetItem *node = p_rootNodes.value(nodeType, nullptr);
-    if (node) {
+    int node = p_rootNodes.value(nodeType, NoNode);
+    if (node != NoNode) {
         return node;
     }
 
+    node = newNode(NoNode, nodeType);
+
     if (m_detachedNodeTypes.contains(nodeType)) {
-        // We want detached nodes always on top of the view, in order of their enum value
-        node = new QTreeWidgetItem(nodeType);
-        int index = 0;
-        while (p_indexTree->topLevelItem(index) && p_indexTree->topLevelItem(index)->type() < nodeType) {
-            ++index;
-        }
-        p_indexTree->insertTopLevelItem(index, node);
+        sortInDetachedRoot(node);
+    }
 
-    } else {
-        node = new QTreeWidgetItem(p_indexTree, nodeType);
+    IndexNode &rootNode = p_nodes[node];
+    rootNode.text = nodeTypeName(nodeType);
+    rootNode.iconType = nodeType;
+    p_rootNodes.insert(nodeType, node);
+
+    return node;
+}
+
+
+int Parser::existingRootNode(int nodeType)
+{
+    const int node = p_rootNodes.value(nodeType, NoNode);
+
+    if (node == NoNode && p_chunkBegin > -1 && p_lineNumber > p_chunkBegin) {
+        // Our master may have one, see takeOverChunk()
+        p_foreignLookup = true;
     }
 
-    const auto nt = p_nodeTypes.value(nodeType);
+    return node;
+}
 
-    node->setText(0, nt.name);
-    if (p_addIcons->isChecked()) {
-    node->setIcon(0, nt.icon);}
-    node->setData(0, NodeData::Line, -1);
-    p_rootNodes.insert(nodeType, node);
+
+int Parser::scopeRoot(const QString &scope)
+{
+    const int node = p_scopeRoots.value(scope, NoNode);
+
+    if (node == NoNode && p_chunkBegin > -1 && p_lineNumber > p_chunkBegin) {
+        // Our master may have one, see takeOverChunk()
+        p_missedScopes.insert(scope);
+    }
 
     return node;
 }
 
 
+void Parser::sortInDetachedRoot(const int node)
+{
+    // We want detached nodes always on top of the view, in order of their enum value
+    const int nodeType = p_nodes.at(node).type;
+    p_topLevelNodes.removeLast();
+    int index = 0;
+    while (index < p_topLevelNodes.size() && p_nodes.at(p_topLevelNodes.at(index)).type < nodeType) {
+        ++index;
+    }
+    p_topLevelNodes.insert(index, node);
+}
+
+
+int Parser::newNode(const int parentNode, const int nodeType)
+{
+    IndexNode node;
+    node.type = nodeType;
+    node.parent = parentNode;
+    p_nodes.append(node);
+
+    if (parentNode == NoNode) {
+        p_topLevelNodes.append(p_nodes.size() - 1);
+    }
+
+    return p_nodes.size() - 1;
+}
+
+
+void Parser::removeNode(const int node)
+{
+    // Nodes refer each other by their position, so we can't really remove the
+    // node from the list, but it will not make it into the index tree
+    IndexNode &n = editNode(node);
+    n.hidden = true;
+    n.listed = false;
+}
+
+
+IndexNode &Parser::editNode(const int node)
+{
+    if (node < p_journalFloor) {
+        p_journal.append({node, p_nodes.at(node)});
+    }
+
+    return p_nodes[node];
+}
+
+
+int Parser::findChild(const int parentNode, const QString &text)
+{
+    if (p_chunkBegin > -1 && p_lineNumber > p_chunkBegin
+        && (parentNode == NoNode || p_rootNodes.key(parentNode, NoNode) != NoNode))
+    {
+        // Our master has there maybe other children, see takeOverChunk()
+        p_foreignLookup = true;
+    }
+
+    for (; p_childIndexSize < p_nodes.size(); ++p_childIndexSize) {
+        const IndexNode &node = p_nodes.at(p_childIndexSize);
+        const QPair<int, QString> key = qMakePair(node.parent, node.text);
+        // Keep the first one, as a search from the top would do
+        if (!p_childIndex.contains(key)) {
+            p_childIndex.insert(key, p_childIndexSize);
+        }
+    }
+
+    return p_childIndex.value(qMakePair(parentNode, text), NoNode);
+}
+
+
+int Parser::childCount(const int node) const
+{
+    int count = 0;
+    for (int i = node + 1; i < p_nodes.size(); ++i) {
+        if (p_nodes.at(i).parent == node) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+
 bool Parser::incrementLineNumber()
 {
-    if (p_lineNumber >= p_document->lines()) {
+    if (p_lineNumber >= documentSize()) {
         return false;
     }
 
@@ -306,80 +447,108 @@ bool Parser::incrementLineNumber()
 }
 
 
-QString Parser::rawLine(int offset /*= 0*/) const
+QStringView Parser::rawLine(int offset /*= 0*/) const
 {
     int lineNumber = p_lineNumber - 1 + offset;
 
-    if (lineNumber >= p_document->lines()) {
-        return QString();
+    if (lineNumber >= documentSize()) {
+        return QStringView();
     }
     if (lineNumber < 0) {
-        return QString();
+        return QStringView();
     }
 
-    return p_document->line(lineNumber);
+    return p_lines.line(lineNumber);
 }
 
 
-QString Parser::nextLineOrBust()
+void Parser::LineSource::take(const QString &text)
 {
-    static const QString headTag(QStringLiteral("<<<<<<< HEAD"));
-    static const QString equalsTag(QStringLiteral("======="));
-    static const QRegularExpression rxShaTag(QStringLiteral(R"(^>>>>>>> (\w+) \((.+)\))"));
+    p_text = text;
+    p_lineStarts.clear();
+    p_lineStarts.append(0);
+
+    for (qsizetype pos = p_text.indexOf(QLatin1Char('\n')); pos > -1; pos = p_text.indexOf(QLatin1Char('\n'), pos + 1)) {
+        p_lineStarts.append(pos + 1);
+    }
+
+    // As if there were a line break behind the last line, so that each line ends
+    // one in front of the start of the next one
+    p_lineStarts.append(p_text.size() + 1);
+}
+
 
-    QString newline = p_document->line(p_lineNumber++);
-    if (!newline.startsWith(headTag)) {
-        return newline;
+QStringView Parser::nextLineOrBust()
+{
+    if (p_cancelParse.loadRelaxed()) {
+        // As if we are at the end, so all master classes stop on their usual way
+        p_lineNumber = documentSize() + 1;
+        return QStringView();
     }
 
-    int conflictLineNumber = p_lineNumber - 1;
+    return p_lines.line(p_lineNumber++);
+}
+
+
+bool Parser::scanGitConflicts()
+{
+    static const QString headTag(QStringLiteral("<<<<<<< HEAD"));
+    static const QString equalsTag(QStringLiteral("======="));
+    static const QRegularExpression rxShaTag(QStringLiteral(R"(^>>>>>>> (\w+) \((.+)\))"));
 
     // To avoid a false detection, we make a book keeping about found "tags"
-    // <<<<<<< HEAD                          was already found, next must be
-    // =======                               and equalsTag and the last
+    // <<<<<<< HEAD                          must be followed by
+    // =======                               the equalsTag and the last
     // >>>>>>> 24175c8 (bla, blub, text)     something like this
-    int state = 1; // 0 = no tag, 1 = HEAD tag, 2 = equals tag, 3 = sha tag
-    bool ok = true;
+    int state = 0; // 0 = no tag, 1 = HEAD tag, 2 = equals tag
+    int conflictLineNumber = 0;
     QRegularExpressionMatch rxMatch;
 
-    for (int ln = p_lineNumber; ln < p_document->lines(); ++ln) {
-        newline = p_document->line(ln);
+    for (int ln = 0; ln < documentSize(); ++ln) {
+        const QStringView line = p_lines.line(ln);
 
-        if (newline.startsWith(headTag)) {
-            conflictLineNumber = ln;
-            ok = (state == 0);
-            state = ok ? 1 : 0;
-        } else if (newline.startsWith(equalsTag)) {
-            ok = (state == 1);
-            state = ok ? 2 : 0;
-        } else if (newline.contains(rxShaTag, &rxMatch)) {
-            ok = (state == 2);
-            state = ok ? 3 : 0;
+        // Nearly each line is sorted out by its first char, no need for more
+        if (line.isEmpty()) {
+            continue;
         }
 
-        if (state == 3 && ok) {
-            if (!p_gitConflict) {
-                p_gitConflict = true;
-                p_lastNode = nullptr;
-                p_rootNodes.clear();
-                p_indexList.clear();
-                p_indexTree->clear();
+        const QChar firstChar = line.at(0);
+        if (firstChar == QLatin1Char('<')) {
+            if (line.startsWith(headTag)) {
+                conflictLineNumber = ln;
+                state = (state == 0) ? 1 : 0;
+            }
+        } else if (firstChar == QLatin1Char('=')) {
+            if (line.startsWith(equalsTag)) {
+                state = (state == 1) ? 2 : 0;
+            }
+        } else if (firstChar == QLatin1Char('>')) {
+            if (line.contains(rxShaTag, &rxMatch)) {
+                if (state == 2) {
+                    if (!p_gitConflict) {
+                        // Drop what prepareForParse() has added, like some root node
+                        p_gitConflict = true;
+                        p_lastNode = NoNode;
+                        p_nodes.clear();
+                        p_topLevelNodes.clear();
+                        p_rootNodes.clear();
+                        clearChildIndex();
+                    }
+                    const int node = newNode(NoNode, GitConflictNode);
+                    setNodeProperties(node, GitConflictNode, rxMatch.captured(2), conflictLineNumber);
+                    setNodeEndLine(node, ln);
+                }
+                state = 0;
             }
-            QTreeWidgetItem *node = new QTreeWidgetItem(p_indexTree, GitConflictNode);
-            setNodeProperties(node, GitConflictNode, rxMatch.captured(2), conflictLineNumber);
-            node->setData(0, NodeData::EndLine, ln);
-            state = 0;
         }
     }
 
-    if (!p_gitConflict) {
-        // False detection and no other full block found
-        return p_document->line(p_lineNumber);
+    if (p_gitConflict) {
+        // As if all lines were parsed
+        p_lineNumber = documentSize();
     }
 
-    p_lineNumber = p_document->lines();
-
-    return QString();
+    return p_gitConflict;
 }
 
 
@@ -387,16 +556,10 @@ bool Parser::appendNextLine()
 {
 //     bool debugA = m_line.isEmpty();
 
-    if (p_lineNumber >= p_document->lines()) {
+    if (p_lineNumber >= documentSize()) {
         return false;
     }
 
-    // Keep the editing responsive when the file is large
-    if (m_runTime.hasExpired(100)) {
-        qApp->processEvents();
-        m_runTime.start();
-    }
-
     if (!m_line.isEmpty()) {
         m_line.append(QLatin1Char(' '));
     }
@@ -412,324 +575,1561 @@ bool Parser::appendNextLine()
 }
 
 
-#ifndef GENERATE_REPORT
-// Status Report generation can be enabled by CMake switch -DREPORT=1
-// or manually here by changing the 0 to 1
-#define GENERATE_REPORT 0
-#endif
-#if GENERATE_REPORT>0
-#include <QFile>
-void Parser::generateReport()
+void Parser::markLinesEdited(int firstLine, int lastLine)
 {
-    QString filePath = document()->url().adjusted(QUrl::RemoveFilename).path();
-
-    if (filePath.endsWith(QLatin1StringView("/KatePlugin-IndexView/tests/"))) {
-        qDebug() << "Update Status Report for file " << filePath + document()->url().fileName();
-        QFile file(filePath + QLatin1StringView("reports/") + document()->url().fileName() + QLatin1StringView(".txt"));
-        if (file.open(QIODevice::WriteOnly)) {
-            QTextStream stream(&file);
-            stream << "Status Report" << Qt::endl
-                   << "===============" << Qt::endl
-                   << "Parser        : " << metaObject()->className() << Qt::endl
-                   << "Parser Version: " << version() << Qt::endl
-                   << "Test File     : KatePlugin-IndexView/tests/" << document()->url().fileName() << Qt::endl
-                   << "File CheckSum : " << document()->checksum().toHex() << Qt::endl
-                   << Qt::endl
-                   << "WARNING! The CheckSum equals the file on disk! Before you commit a changed" << Qt::endl
-                   << "         report, reload (F5) the Test File to be save!" << Qt::endl
-                   << Qt::endl << Qt::endl
-                   << "View Options" << Qt::endl
-                   << "--------------" << Qt::endl
-                   << "Needless to say, but CHANGES HERE affect the result THERE!" << Qt::endl
-                   << "So, something should only change here if options are added or removed." << Qt::endl
-                   << "In any other case adjust the view options and trigger a new parsing." << Qt::endl
-                   << Qt::endl;
-            for (QAction *action : contextMenu()->actions()) {
-                if (action->isSeparator()) {
-                    continue;
-                }
-                stream << qSetFieldWidth(38) << Qt::right
-                       << action->text()
-                       << qSetFieldWidth(0) << Qt::left
-                       << QLatin1StringView(" : ") + QLatin1StringView(action->isChecked() ? "yes" : "no")
-                       << Qt::endl;
-            }
-
-            stream << Qt::endl << Qt::endl << qSetFieldWidth(0) << Qt::left
-                   << "List of Nodes" << Qt::endl
-                   << "---------------" << Qt::endl;
-            for (int i = 0; i < p_indexList.size(); ++i) {
-                QTreeWidgetItem *item = p_indexList.at(i);
-                stream << qSetFieldWidth(80) << Qt::center << item->text(0) << qSetFieldWidth(0) << Qt::endl;
-            }
-
-            stream << qSetFieldWidth(0) << Qt::endl << Qt::endl << Qt::left
-                   << "List of Nodes with line numbers" << Qt::endl
-                   << "---------------------------------" << Qt::endl
-                   << qSetFieldWidth(6) << Qt::left << "Node" << qSetFieldWidth(50) << "Node-Text" << qSetFieldWidth(0) << "Line Column EndLine" << Qt::endl;
-            for (int i = 0; i < p_indexList.size(); ++i) {
-                QTreeWidgetItem *item = p_indexList.at(i);
-                stream << qSetFieldWidth(4) << Qt::right << i << qSetFieldWidth(2) << " "
-                       << qSetFieldWidth(50) << Qt::left << item->text(0)
-                       << qSetFieldWidth(4) << Qt::right << item->data(0, NodeData::Line).toInt()
-                       << qSetFieldWidth(5) << item->data(0, NodeData::Column).toInt()
-                       << qSetFieldWidth(7) << item->data(0, NodeData::EndLine).toInt()<< Qt::endl;
-            }
-        }
+    // Lines behind the edit keep their distance to the end of the document, no matter
+    // what is edited in front of them. So we remember how many lines at the end are
+    // still untouched, which is not affected by later edits
+    const int tail = qMax(0, p_document->lines() - 1 - lastLine);
+
+    if (p_editedBegin < 0) {
+        p_editedBegin = firstLine;
+        p_uneditedTail = tail;
+    } else {
+        p_editedBegin = qMin(p_editedBegin, firstLine);
+        p_uneditedTail = qMin(p_uneditedTail, tail);
     }
 }
-#else
-void Parser::generateReport()
-{
-    // Nothing todo! Guess the compiler will remove the entire call in this case
-    return;
-}
-#endif
 
 
-void Parser::parse()
+int Parser::resumePoint() const
 {
-    if (!needsUpdate()) {
-        // I'm stubborn and don't want unneeded CPU waste
-        return;
+    if (p_fullParseNeeded || p_editedBegin < 0) {
+        return -1;
     }
 
-    if (isParsing()) {
-        // Don't do stupid stuff! We may crash!
-        return;
+    // The state of a checkpoint depends only on the lines in front of it
+    int index = -1;
+    for (int i = 0; i < p_checkpoints.size(); ++i) {
+        if (p_checkpoints.at(i).lineNumber >= p_editedBegin) {
+            break;
+        }
+        index = i;
     }
 
-    p_docNeedParsing = false;
-    p_parsingIsRunning = true;
-
-    p_gitConflict = false;
-    p_mustyTree = p_indexTree;
-    p_indexTree = new QTreeWidget();
-    p_indexList.clear();
+    return index;
+}
 
-    p_lastNode = nullptr;
-    p_rootNodes.clear();
-    p_usefulOptions.clear();
-    m_funcAtWork.clear();
-    p_lineNumber = 0;
 
-    // Make all options visible because "not visible" is treated by Qt as "not enabled"
-    for (auto it = p_nodeTypes.constBegin(); it != p_nodeTypes.constEnd(); ++it) {
-        if (it.value().option) {
-            it.value().option->setVisible(true);
-        }
+bool Parser::passCheckpoint()
+{
+    if (p_gitConflict) {
+        return false;
     }
 
-    if (p_nesting1) {
-        p_nesting1->setVisible(true);
-        p_nesting2->setVisible(true);
-        p_nesting3->setVisible(true);
-        p_nesting4->setVisible(true);
+    if (p_resuming && p_lineNumber >= p_cleanLine && p_lineNumber < documentSize()) {
+        if (takeOverPreviousRun()) {
+            return true;
+        }
     }
 
-    // Enable (or not) view options with respect of their dependencies
-    for (int i = 0; i < p_modifierOptions.size(); ++i) {
-        p_modifierOptions.at(i).dDent->setEnabled(p_modifierOptions.at(i).dDency->isChecked() && p_modifierOptions.at(i).dDency->isEnabled());
+    if (p_chunkEnd > -1 && p_lineNumber >= p_chunkEnd) {
+        // We parse a chunk for our master, which go on from here
+        saveCheckpoint();
+        return true;
     }
 
-    prepareForParse();
-    m_runTime.start();
-    parseDocument();
-    generateReport();
-
-    if (p_gitConflict) {
-        p_indexTree->setFocusPolicy(Qt::NoFocus);
-        p_indexTree->setLayoutDirection(Qt::LeftToRight);
-        p_indexTree->setHeaderLabel(i18nc("@title:column", ">>>  GIT CONFLICT  <<<"));
-        p_indexTree->setContextMenuPolicy(Qt::NoContextMenu);
-        p_indexTree->setIndentation(10);
-        p_indexTree->setRootIsDecorated(0);
-        Q_EMIT parsingDone(this);
-        return;
+    if (p_nextChunkRun < p_chunkRuns.size() && takeOverChunks()) {
+        return true;
     }
 
-    // Keep the context menu free from useless options
-    for (auto it = p_nodeTypes.constBegin(); it != p_nodeTypes.constEnd(); ++it) {
-        if (it.value().option) {
-            it.value().option->setVisible(p_usefulOptions.contains(it.value().option));
-        }
+    if (p_lineNumber < p_nextCheckpoint && p_lineNumber < documentSize() && !p_chunkLines.contains(p_lineNumber)) {
+        return false;
     }
 
-    if (p_nesting1) {
-        p_nesting1->setVisible(p_maxNesting > 0);
+    saveCheckpoint();
+    p_nextCheckpoint = p_lineNumber + Checkpoint_Interval;
 
-        p_nesting2->setVisible(p_maxNesting > 1);
-        p_nesting2->setEnabled(p_nesting1->isChecked() && p_nesting1->isEnabled());
+    return false;
+}
 
-        p_nesting3->setVisible(p_maxNesting > 2);
-        p_nesting3->setEnabled(p_nesting2->isChecked() && p_nesting2->isEnabled());
 
-        p_nesting4->setVisible(p_maxNesting > 3);
-        p_nesting4->setEnabled(p_nesting3->isChecked() && p_nesting3->isEnabled());
+void Parser::saveCheckpoint()
+{
+    Checkpoint cp;
+    cp.lineNumber = p_lineNumber;
+    cp.nodeCount = p_nodes.size();
+    cp.journalSize = p_journal.size();
+    cp.lastNode = p_lastNode;
+    cp.nestingLevel = p_nestingLevel;
+    cp.maxNesting = p_maxNesting;
+    cp.line = m_line;
+    cp.funcAtWork = m_funcAtWork;
+    cp.topLevelNodes = p_topLevelNodes;
+    cp.rootNodes = p_rootNodes;
+    cp.scopeRoots = p_scopeRoots;
+    cp.usefulNodeTypes = p_usefulNodeTypes;
+    saveScanState(cp.scanState);
+
+    if (!p_checkpoints.isEmpty() && p_checkpoints.last().lineNumber == p_lineNumber) {
+        // Happens at the end of the document, the latest state is the valid one
+        p_checkpoints.last() = cp;
+    } else {
+        p_checkpoints.append(cp);
     }
 
-    for (int i = 0; i < p_modifierOptions.size(); ++i) {
-        p_modifierOptions.at(i).dDent->setVisible(p_modifierOptions.at(i).dDency->isVisible());
-    }
+    p_journalFloor = p_nodes.size();
+}
 
-    if (!p_viewTree->isChecked()) {
-        // To offer a plain list of our hard-raised tree, we must hack him in pieces again :-(
-        // We do it this way because the tree help us to decide what todo while parsing. And because
-        // we have already a list of our nodes of interest (p_indexList), we use this list to decide
-        // how to process with each node, keep or delete.
-
-        // We cut each "main" limb off the tree until he is empty..
-        while (p_indexTree->topLevelItemCount() > 0) {
-            QTreeWidgetItem *item = p_indexTree->takeTopLevelItem(0);
-            while (item->childCount() > 0) {
-                QTreeWidgetItem *ci = item->takeChild(0);
-                if (ci->isHidden()) {
-                    // A hidden one is not needed and can be deleted now
-                    delete ci;
-                } else if (!p_indexList.contains(ci)) {
-                    // Not in list, drop it. Unlikely for child nodes, but who knows
-                    delete ci;
-                }
-            }
 
-            if (!p_indexList.contains(item)) {
-                // Not in list, drop it. Happens often for top level nodes.
-                delete item;
-            }
+void Parser::restoreCheckpoint(int index)
+{
+    const Checkpoint &cp = p_previousRun.checkpoints.at(index);
+
+    // Undo all changes done after the checkpoint and cut off the newer nodes
+    clearChildIndex();
+    p_nodes = p_previousRun.nodes;
+    for (int i = p_previousRun.journal.size() - 1; i >= cp.journalSize; --i) {
+        const JournalEntry &entry = p_previousRun.journal.at(i);
+        if (entry.node < cp.nodeCount) {
+            p_nodes[entry.node] = entry.value;
         }
+    }
+    p_nodes.resize(cp.nodeCount);
+
+    p_journal = p_previousRun.journal.first(cp.journalSize);
+    p_checkpoints = p_previousRun.checkpoints.first(index + 1);
+    p_journalFloor = cp.nodeCount;
+    p_nextCheckpoint = cp.lineNumber + Checkpoint_Interval;
+    p_resumeNodeCount = cp.nodeCount;
+
+    p_lineNumber = cp.lineNumber;
+    p_lastNode = cp.lastNode;
+    p_nestingLevel = cp.nestingLevel;
+    p_maxNesting = cp.maxNesting;
+    m_line = cp.line;
+    m_funcAtWork = cp.funcAtWork;
+    p_topLevelNodes = cp.topLevelNodes;
+    p_rootNodes = cp.rootNodes;
+    p_scopeRoots = cp.scopeRoots;
+    p_usefulNodeTypes = cp.usefulNodeTypes;
+
+    ScanState state = cp.scanState;
+    restoreScanState(state);
+}
 
-        // ...and now add the (good) nodes again to our non-tree..tree widget
-        for (int i = 0; i < p_indexList.size(); ++i) {
-            QTreeWidgetItem *item = p_indexList.at(i);
-            while (item->childCount() > 0) {
-                QTreeWidgetItem *ci = item->takeChild(0);
-                if (ci->isHidden()) {
-                    delete ci;
-                } else if (!p_indexList.contains(ci)) {
-                    delete ci;
-                }
-            }
-            // Here is the beef!
-            p_indexTree->addTopLevelItem(p_indexList.at(i));
-        }
 
-        // We need to take care of p_lastNode or we can crash e.g. with DocumentParser::parse()
-        if (!p_indexList.contains(p_lastNode)) {
-            p_lastNode = nullptr;
-        }
+void Parser::saveScanState(ScanState &state) const
+{
+    // Parser itself has nothing more to save, all is done by saveCheckpoint()
+    Q_UNUSED(state)
+}
 
-        p_indexTree->setRootIsDecorated(0);
-    }
 
-    p_indexTree->setFocusPolicy(Qt::NoFocus);
-    p_indexTree->setLayoutDirection(Qt::LeftToRight);
-    p_indexTree->setHeaderLabels({i18nc("@title:column", "Index")});
-    p_indexTree->setContextMenuPolicy(Qt::CustomContextMenu);
-    p_indexTree->setIndentation(10);
+void Parser::restoreScanState(ScanState &state)
+{
+    Q_UNUSED(state)
+}
+
 
-    if (showSorted()) {
-        p_indexTree->setSortingEnabled(true);
-        p_indexTree->sortItems(0, p_mustyTree->header()->sortIndicatorOrder());
+int Parser::mapLine(int oldLine) const
+{
+    if (p_adoptingChunk) {
+        // The chunk parser run on the same snapshot
+        return oldLine;
     }
 
+    if (oldLine < p_editBegin) {
+        // Also true for -1, the unknown line
+        return oldLine;
+    }
 
-    Q_EMIT parsingDone(this);
+    if (oldLine >= p_previousRun.cleanLine) {
+        return oldLine + p_lineDelta;
+    }
+
+    return Unmappable;
 }
 
 
-void Parser::burnDownMustyTree()
+bool Parser::translateScanState(ScanState &state)
 {
-    if (!isParsing()) {
-        return;
-    }
+    bool ok = true;
 
-    // Restore scroll position from old tree to avoid flicker...
-    p_indexTree->verticalScrollBar()->setSliderPosition(p_mustyTree->verticalScrollBar()->sliderPosition());
-    // ...but ensure current item is visible
-    p_indexTree->scrollToItem(p_indexTree->currentItem());
+    for (int &node : state.p_nodes) {
+        node = mapNode(node);
+        ok = ok && node != Unmappable;
+    }
+    for (int &lineNumber : state.p_lines) {
+        lineNumber = mapLine(lineNumber);
+        ok = ok && lineNumber != Unmappable;
+    }
 
-    delete p_mustyTree;
-    p_parsingIsRunning = false;
+    return ok;
 }
 
 
-bool Parser::nodeTypeIsWanted(int nodeType)
+IndexNode Parser::previousNode(int index, int node) const
 {
-    QAction *viewOption = p_nodeTypes.value(nodeType).option;
+    const QList<JournalEntry> &journal = p_previousRun.journal;
 
-    if (!viewOption) {
-        // Prior was an option mandatory, but now I think this way is better
-        return true;
+    // The first change after the checkpoint knows how it was
+    for (int i = p_previousRun.checkpoints.at(index).journalSize; i < journal.size(); ++i) {
+        if (journal.at(i).node == node) {
+            return journal.at(i).value;
+        }
     }
 
-    p_usefulOptions.insert(viewOption);
+    return p_previousRun.nodes.at(node);
+}
 
-    if (!viewOption->isChecked() || !viewOption->isEnabled()) {
-        return false;
-    }
 
-    return true;
+bool Parser::equalNode(const IndexNode &oldNode, const IndexNode &node)
+{
+    const IndexNode &o = oldNode;
+    const IndexNode &n = node;
+
+    return o.type == n.type && o.iconType == n.iconType && o.text == n.text && o.column == n.column
+        && o.hidden == n.hidden && o.expanded == n.expanded && o.listed == n.listed
+        && mapLine(o.line) == n.line && mapLine(o.endLine) == n.endLine && mapNode(o.parent) == n.parent;
 }
 
 
-void Parser::setNodeProperties(QTreeWidgetItem *const node, const int nodeType, const QString &text, const int lineNumber, const int columnNumber/* = 0*/)
+int Parser::mapNode(int oldNode)
 {
-    if (!node) {
-        return;
+    if (p_adoptingChunk) {
+        // All nodes are already mapped by takeOverChunk()
+        return oldNode == NoNode ? NoNode : p_mappedNodes.value(oldNode, Unmappable);
     }
 
-    // The size of 45 is choosen to fit into the Status Report (sure could be changed..)
-    // but I think no one need such long lines (ok, maybe these who want parameter to see..)
-    if (text.size() > 45) {
-        node->setText(0, text.first(45) + QStringLiteral("…"));
-    } else {
-        node->setText(0, text);
+    if (oldNode < p_resumeNodeCount) {
+        // Also true for NoNode
+        return oldNode;
     }
 
-    if (p_addIcons->isChecked()) {
-    node->setIcon(0, p_nodeTypes.value(nodeType).icon); }
-    node->setData(0, NodeData::Line, lineNumber);
-    node->setData(0, NodeData::Column, columnNumber);
-    node->setData(0, NodeData::EndLine, -1); // ATM, we don't know the end line
+    const int newNode = oldNode + p_matchNodeCount - p_matchOldNodeCount;
 
-    if (p_viewExpanded->isChecked()) {
-        p_indexTree->expandItem(node->parent());
+    if (oldNode >= p_matchOldNodeCount) {
+        return newNode;
     }
 
-    if (m_detachedNodeTypes.contains(nodeType)) {
-        node->setData(0, NodeData::EndLine, lineNumber);
-    } else {
-        p_lastNode = node;
+    // A node added while we run in parallel to the old result, there must be
+    // an equal one at the same distance to the checkpoint
+    const auto it = p_mappedNodes.constFind(oldNode);
+    if (it != p_mappedNodes.constEnd()) {
+        return it.value();
     }
 
-    p_maxNesting = qMax(p_maxNesting, p_nestingLevel);
+    int result = Unmappable;
 
-    if (!nodeTypeIsWanted(nodeType) || (p_nestingAllowed < (p_nestingLevel + p_nestingLevelAdjustment))) {
-        node->setHidden(true);
-    } else {
-        p_indexList.append(node);
+    if (newNode >= p_resumeNodeCount && newNode < p_matchNodeCount) {
+        if (equalNode(previousNode(p_matchCheckpoint, oldNode), p_nodes.at(newNode))) {
+            result = newNode;
+        }
     }
-}
 
+    p_mappedNodes.insert(oldNode, result);
 
-void Parser:: menuActionTriggered()
-{
-    docNeedParsing();
-    // This call may a little fishy, hm...proper may to emit a signal that we need an update
-    parse();
-    p_viewOptionsChanged = true;
+    return result;
 }
 
 
-QAction *Parser::addViewOption(const QString &name, const QString &caption)
+bool Parser::takeOverPreviousRun()
 {
-    QAction *viewOption = p_menu.addAction(caption, this, &Parser::menuActionTriggered);
-    viewOption->setCheckable(true);
+    const QList<Checkpoint> &oldCheckpoints = p_previousRun.checkpoints;
+    const int oldLineNumber = p_lineNumber - p_lineDelta;
 
-    // The object name must be unique due to use as config key
-    if (p_menu.findChild<QAction*>(name)) {
-        QString uniqueName;
-        int i = 1;
+    const auto it = std::lower_bound(oldCheckpoints.cbegin(), oldCheckpoints.cend(), oldLineNumber,
+                                     [](const Checkpoint &cp, int line) { return cp.lineNumber < line; });
+
+    if (it == oldCheckpoints.cend() || it->lineNumber != oldLineNumber) {
+        return false;
+    }
+
+    const int match = it - oldCheckpoints.cbegin();
+    const int last = oldCheckpoints.size() - 1;
+
+    // Without a checkpoint at the end of the document we don't know the final state
+    if (match >= last || oldCheckpoints.at(last).lineNumber < p_previousRun.documentSize) {
+        return false;
+    }
+
+    // First the cheap tests...
+    const Checkpoint &cp = oldCheckpoints.at(match);
+    if (cp.nestingLevel != p_nestingLevel || cp.line != m_line || cp.funcAtWork != m_funcAtWork
+        || cp.rootNodes.size() != p_rootNodes.size() || cp.scopeRoots.size() != p_scopeRoots.size()
+        || cp.topLevelNodes.size() != p_topLevelNodes.size())
+    {
+        return false;
+    }
+
+    p_matchCheckpoint = match;
+    p_matchNodeCount = p_nodes.size();
+    p_matchOldNodeCount = cp.nodeCount;
+    p_mappedNodes.clear();
+
+    // ...then these where nodes must be compared
+    if (mapNode(cp.lastNode) != p_lastNode) {
+        return false;
+    }
+    for (auto i = cp.rootNodes.cbegin(); i != cp.rootNodes.cend(); ++i) {
+        if (mapNode(i.value()) != p_rootNodes.value(i.key(), Unmappable)) {
+            return false;
+        }
+    }
+    for (auto i = cp.scopeRoots.cbegin(); i != cp.scopeRoots.cend(); ++i) {
+        if (mapNode(i.value()) != p_scopeRoots.value(i.key(), Unmappable)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < cp.topLevelNodes.size(); ++i) {
+        if (mapNode(cp.topLevelNodes.at(i)) != p_topLevelNodes.at(i)) {
+            return false;
+        }
+    }
+
+    // ...and last but not least the state of the master class
+    ScanState currentState;
+    saveScanState(currentState);
+    ScanState previousState = cp.scanState;
+    if (!translateScanState(previousState) || previousState != currentState) {
+        return false;
+    }
+
+    if (!adoptPreviousRun(match)) {
+        return false;
+    }
+
+    // There is nothing more to compare
+    p_resuming = false;
+
+    return true;
+}
+
+
+bool Parser::adoptPreviousRun(int match)
+{
+    const QList<Checkpoint> &oldCheckpoints = p_previousRun.checkpoints;
+    const int last = oldCheckpoints.size() - 1;
+
+    // The state is the same, so would be the rest of our run. Collect the old result as it was
+    // at each following checkpoint, so that these stay usable. The journal has only the values
+    // before a change, so we go backwards from the final result to the checkpoint
+    const QList<IndexNode> &oldNodes = p_previousRun.nodes;
+    const QList<JournalEntry> &oldJournal = p_previousRun.journal;
+    QHash<int, IndexNode> overlay; // Old nodes as they were at the checkpoint we are currently at
+    auto oldNode = [&oldNodes, &overlay](int node) {
+        const auto it = overlay.constFind(node);
+        return it != overlay.constEnd() ? it.value() : oldNodes.at(node);
+    };
+
+    for (int i = oldJournal.size() - 1; i >= oldCheckpoints.at(last).journalSize; --i) {
+        overlay.insert(oldJournal.at(i).node, oldJournal.at(i).value);
+    }
+
+    struct Change {
+        int         node;
+        IndexNode   before;
+        IndexNode   after;
+    };
+    struct Step {
+        QList<IndexNode>    nodes;   // Added nodes
+        QList<Change>       changes; // of older nodes
+    };
+    QList<Step> steps(last - match);
+
+    for (int k = last - 1; k >= match; --k) {
+        Step &step = steps[k - match];
+        QList<Change> known; // Added nodes we have already, like a root node of a chunk
+        for (int i = oldCheckpoints.at(k).nodeCount; i < oldCheckpoints.at(k + 1).nodeCount; ++i) {
+            const int node = mapNode(i);
+            if (node >= 0 && node < p_matchNodeCount) {
+                known.append({i, IndexNode(), oldNode(i)});
+                continue;
+            }
+            step.nodes.append(oldNode(i));
+        }
+
+        QSet<int> changed;
+        for (int i = oldCheckpoints.at(k).journalSize; i < oldCheckpoints.at(k + 1).journalSize; ++i) {
+            changed.insert(oldJournal.at(i).node);
+        }
+        for (const int node : std::as_const(changed)) {
+            step.changes.append({node, IndexNode(), oldNode(node)});
+        }
+        for (int i = oldCheckpoints.at(k + 1).journalSize - 1; i >= oldCheckpoints.at(k).journalSize; --i) {
+            overlay.insert(oldJournal.at(i).node, oldJournal.at(i).value);
+        }
+        for (Change &change : step.changes) {
+            change.before = oldNode(change.node);
+        }
+        step.changes.append(known);
+    }
+
+    // Translate all to our current run, when something has no counterpart we must go on parsing
+    auto translate = [this](IndexNode &node) {
+        node.parent = mapNode(node.parent);
+        node.line = mapLine(node.line);
+        node.endLine = mapLine(node.endLine);
+        return node.parent != Unmappable && node.line != Unmappable && node.endLine != Unmappable;
+    };
+
+    QSet<int> parents; // Old nodes which got new children or changed children
+    for (Step &step : steps) {
+        for (IndexNode &node : step.nodes) {
+            if (node.parent < p_matchOldNodeCount && node.parent != NoNode) {
+                parents.insert(node.parent);
+            }
+            if (!translate(node)) {
+                return false;
+            }
+        }
+        for (Change &change : step.changes) {
+            if (change.before.parent != NoNode && change.before.parent < p_matchOldNodeCount) {
+                parents.insert(change.before.parent);
+            }
+            change.node = mapNode(change.node);
+            if (change.node < 0) {
+                return false;
+            }
+            // The old values may refer to edited lines, but we only use these which were changed
+            if ((change.before.line != change.after.line && mapLine(change.after.line) == Unmappable)
+                || (change.before.endLine != change.after.endLine && mapLine(change.after.endLine) == Unmappable))
+            {
+                return false;
+            }
+        }
+    }
+
+    // Children may searched by their text, e.g. with findChild(), and we have not noticed when the
+    // old run had found some other child than we would do. A chunk parser notice that itself
+    if (!p_adoptingChunk) {
+        QHash<int, QStringList> oldChildren;
+        QHash<int, QStringList> newChildren;
+        for (int i = p_resumeNodeCount; i < p_matchOldNodeCount; ++i) {
+            const IndexNode node = oldNode(i);
+            if (parents.contains(node.parent)) {
+                oldChildren[node.parent].append(node.text);
+            }
+        }
+        QHash<int, int> mappedParents;
+        for (const int parent : std::as_const(parents)) {
+            const int newParent = mapNode(parent);
+            if (newParent == Unmappable) {
+                return false;
+            }
+            mappedParents.insert(newParent, parent);
+        }
+        for (int i = p_resumeNodeCount; i < p_matchNodeCount; ++i) {
+            const int parent = p_nodes.at(i).parent;
+            if (mappedParents.contains(parent)) {
+                newChildren[mappedParents.value(parent)].append(p_nodes.at(i).text);
+            }
+        }
+        if (oldChildren != newChildren) {
+            return false;
+        }
+    }
+
+    // And finally the following checkpoints
+    QList<Checkpoint> checkpoints;
+    for (int k = match + 1; k <= last; ++k) {
+        Checkpoint c = oldCheckpoints.at(k);
+        bool ok = true;
+        c.lineNumber = mapLine(c.lineNumber);
+        c.maxNesting = qMax(c.maxNesting, p_maxNesting);
+        c.usefulNodeTypes.unite(p_usefulNodeTypes);
+        c.lastNode = mapNode(c.lastNode);
+        ok = ok && c.lastNode != Unmappable;
+        for (int &node : c.topLevelNodes) {
+            node = mapNode(node);
+            ok = ok && node != Unmappable;
+        }
+        for (int &node : c.rootNodes) {
+            node = mapNode(node);
+            ok = ok && node != Unmappable;
+        }
+        for (auto it = p_rootNodes.cbegin(); it != p_rootNodes.cend(); ++it) {
+            // A chunk parser may not have all of ours
+            if (!c.rootNodes.contains(it.key())) {
+                c.rootNodes.insert(it.key(), it.value());
+            }
+        }
+        for (int &node : c.scopeRoots) {
+            node = mapNode(node);
+            ok = ok && node != Unmappable;
+        }
+        for (auto it = p_scopeRoots.cbegin(); it != p_scopeRoots.cend(); ++it) {
+            // Same as above, takeOverChunk() has ensured that the chunk has not missed them
+            if (!c.scopeRoots.contains(it.key())) {
+                c.scopeRoots.insert(it.key(), it.value());
+            }
+        }
+        ok = translateScanState(c.scanState) && ok;
+        if (!ok) {
+            if (k == last) {
+                return false;
+            }
+            // Not needed, only one chance less to resume
+            c.lineNumber = -1;
+        }
+        checkpoints.append(c);
+    }
+
+    // All fine, take it over
+    saveCheckpoint();
+    clearChildIndex();
+
+    for (int k = 0; k < steps.size(); ++k) {
+        const int firstNode = p_nodes.size();
+        p_nodes.append(steps.at(k).nodes);
+        if (p_adoptingChunk) {
+            // The top level nodes of the chunk are merged with ours, as newNode() and rootNode() would do
+            for (int node = firstNode; node < p_nodes.size(); ++node) {
+                const int nodeType = p_nodes.at(node).type;
+                if (p_nodes.at(node).parent != NoNode) {
+                    continue;
+                }
+                p_topLevelNodes.append(node);
+                if (m_detachedNodeTypes.contains(nodeType) && checkpoints.at(k).rootNodes.value(nodeType, NoNode) == node) {
+                    sortInDetachedRoot(node);
+                }
+            }
+        }
+        for (const Change &change : steps.at(k).changes) {
+            IndexNode &node = editNode(change.node);
+            const IndexNode &before = change.before;
+            const IndexNode &after = change.after;
+            if (before.text != after.text) {
+                node.text = after.text;
+            }
+            if (before.iconType != after.iconType) {
+                node.iconType = after.iconType;
+            }
+            if (before.line != after.line) {
+                node.line = mapLine(after.line);
+            }
+            if (before.column != after.column) {
+                node.column = after.column;
+            }
+            if (before.endLine != after.endLine) {
+                node.endLine = mapLine(after.endLine);
+            }
+            if (before.hidden != after.hidden) {
+                node.hidden = after.hidden;
+            }
+            if (before.expanded != after.expanded) {
+                node.expanded = after.expanded;
+            }
+            if (before.listed != after.listed) {
+                node.listed = after.listed;
+            }
+        }
+
+        Checkpoint &c = checkpoints[k];
+        c.nodeCount = p_nodes.size();
+        if (p_adoptingChunk) {
+            c.topLevelNodes = p_topLevelNodes;
+        }
+        if (c.lineNumber < 0) {
+            continue;
+        }
+        c.journalSize = p_journal.size();
+        p_checkpoints.append(c);
+        p_journalFloor = c.nodeCount;
+    }
+
+    const Checkpoint &finalState = checkpoints.last();
+    p_lineNumber = finalState.lineNumber;
+    p_lastNode = finalState.lastNode;
+    p_nestingLevel = finalState.nestingLevel;
+    p_maxNesting = finalState.maxNesting;
+    m_line = finalState.line;
+    m_funcAtWork = finalState.funcAtWork;
+    p_topLevelNodes = finalState.topLevelNodes;
+    p_rootNodes = finalState.rootNodes;
+    p_scopeRoots = finalState.scopeRoots;
+    p_usefulNodeTypes = finalState.usefulNodeTypes;
+
+    ScanState state = finalState.scanState;
+    restoreScanState(state);
+
+    return true;
+}
+
+
+bool Parser::takeOverChunks()
+{
+    bool done = false;
+
+    while (p_nextChunkRun < p_chunkRuns.size() && p_chunkRuns.at(p_nextChunkRun).beginLine <= p_lineNumber) {
+        const ChunkRun &run = p_chunkRuns.at(p_nextChunkRun++);
+        if (run.beginLine < p_lineNumber) {
+            // We have passed it, the chunk is ours
+            run.parser->p_cancelParse.storeRelaxed(1);
+            continue;
+        }
+
+        // We run on the global thread pool, as the chunk runs, the blockingMap() of
+        // DocumentParser::lineType() and the writer of the result cache do. When all its
+        // threads are busy, this doesn't deadlock only because QFuture::waitForFinished()
+        // runs a chunk which has not started yet in our thread
+        QFuture<void> future = run.future;
+        future.waitForFinished();
+
+        if (takeOverChunk(run)) {
+            ++p_chunksTakenOver;
+            p_nextCheckpoint = p_lineNumber + Checkpoint_Interval;
+            done = p_lineNumber >= documentSize();
+        }
+    }
+
+    return done;
+}
+
+
+bool Parser::takeOverChunk(const ChunkRun &run)
+{
+    const Parser *chunk = run.parser;
+    const QList<Checkpoint> &chunkCheckpoints = chunk->p_checkpoints;
+
+    if (chunk->p_cancelParse.loadRelaxed() || chunk->p_foreignLookup) {
+        return false;
+    }
+
+    auto checkpointAt = [](const QList<Checkpoint> &checkpoints, int lineNumber) {
+        const auto it = std::lower_bound(checkpoints.cbegin(), checkpoints.cend(), lineNumber,
+                                         [](const Checkpoint &cp, int line) { return cp.lineNumber < line; });
+        return it != checkpoints.cend() && it->lineNumber == lineNumber ? int(it - checkpoints.cbegin()) : -1;
+    };
+
+    // The chunk parser must have been where we are now, and we where it has started
+    const int match = checkpointAt(chunkCheckpoints, p_lineNumber);
+    const int warmUp = checkpointAt(p_checkpoints, run.warmUpLine);
+    if (match < 0 || match >= chunkCheckpoints.size() - 1 || warmUp < 0) {
+        return false;
+    }
+
+    // First the cheap tests...
+    const Checkpoint &cp = chunkCheckpoints.at(match);
+    if (cp.nestingLevel != p_nestingLevel || cp.line != m_line || cp.funcAtWork != m_funcAtWork) {
+        return false;
+    }
+
+    p_previousRun.nodes = chunk->p_nodes;
+    p_previousRun.journal = chunk->p_journal;
+    p_previousRun.checkpoints = chunkCheckpoints;
+    p_previousRun.documentSize = documentSize();
+    p_matchCheckpoint = match;
+    p_matchNodeCount = p_nodes.size();
+    p_matchOldNodeCount = cp.nodeCount;
+    p_mappedNodes.clear();
+    p_adoptingChunk = true;
+
+    auto takeOver = [&]() {
+        // ...then the nodes, the root nodes are mapped by their type...
+        for (auto it = cp.rootNodes.cbegin(); it != cp.rootNodes.cend(); ++it) {
+            const int root = p_rootNodes.value(it.key(), NoNode);
+            if (root == NoNode) {
+                return false;
+            }
+            p_mappedNodes.insert(it.value(), root);
+        }
+
+        // ...as are the scope roots we had before the warm-up line. When the chunk has
+        // missed one of ours it has added a second one, and all behind would differ
+        for (const QString &scope : chunk->p_missedScopes) {
+            if (p_scopeRoots.contains(scope)) {
+                return false;
+            }
+        }
+        const int warmUpNodeCount = p_checkpoints.at(warmUp).nodeCount;
+        for (auto it = cp.scopeRoots.cbegin(); it != cp.scopeRoots.cend(); ++it) {
+            const int scopeRoot = p_scopeRoots.value(it.key(), NoNode);
+            if (scopeRoot == NoNode) {
+                return false;
+            }
+            if (scopeRoot < warmUpNodeCount) {
+                p_mappedNodes.insert(it.value(), scopeRoot);
+            }
+        }
+
+        // ...all others must be the same we have added since the warm-up line
+        const QList<int> rootList = p_rootNodes.values();
+        const QSet<int> roots(rootList.cbegin(), rootList.cend());
+        int node = warmUpNodeCount;
+        for (int i = 0; i < cp.nodeCount; ++i) {
+            if (p_mappedNodes.contains(i)) {
+                continue;
+            }
+            while (node < p_nodes.size() && roots.contains(node)) {
+                ++node;
+            }
+            if (node >= p_nodes.size() || !equalNode(previousNode(match, i), p_nodes.at(node))) {
+                return false;
+            }
+            p_mappedNodes.insert(i, node++);
+        }
+        while (node < p_nodes.size() && roots.contains(node)) {
+            ++node;
+        }
+        if (node < p_nodes.size()) {
+            return false;
+        }
+
+        // ...and last but not least the state of the master class
+        if (mapNode(cp.lastNode) != p_lastNode) {
+            return false;
+        }
+        for (auto it = cp.scopeRoots.cbegin(); it != cp.scopeRoots.cend(); ++it) {
+            if (mapNode(it.value()) != p_scopeRoots.value(it.key())) {
+                return false;
+            }
+        }
+        ScanState currentState;
+        saveScanState(currentState);
+        ScanState chunkState = cp.scanState;
+        if (!translateScanState(chunkState) || chunkState != currentState) {
+            return false;
+        }
+
+        // The nodes behind are appended to ours, except the root nodes we have already
+        const QHash<int, int> &chunkRoots = chunkCheckpoints.last().rootNodes;
+        for (auto it = chunkRoots.cbegin(); it != chunkRoots.cend(); ++it) {
+            if (it.value() >= cp.nodeCount && p_rootNodes.contains(it.key())) {
+                p_mappedNodes.insert(it.value(), p_rootNodes.value(it.key()));
+            }
+        }
+        int next = p_nodes.size();
+        for (int i = cp.nodeCount; i < chunkCheckpoints.last().nodeCount; ++i) {
+            if (!p_mappedNodes.contains(i)) {
+                p_mappedNodes.insert(i, next++);
+            }
+        }
+
+        return adoptPreviousRun(match);
+    };
+
+    const bool done = takeOver();
+
+    p_adoptingChunk = false;
+    p_previousRun = PreviousRun();
+    p_mappedNodes.clear();
+
+    return done;
+}
+
+
+void Parser::startChunkRuns()
+{
+    p_nextChunkRun = 0;
+    p_chunksTakenOver = 0;
+
+    if (!p_chunkRunsEnabled || p_resuming || documentSize() < 2 * Chunk_MinSize) {
+        return;
+    }
+
+    const QList<int> borders = chunkBorders();
+    const int chunkSize = qMax(Chunk_MinSize, documentSize() / qMax(1, QThread::idealThreadCount()));
+
+    int chunkBegin = 0;
+    for (int i = 1; i < borders.size(); ++i) {
+        const int border = borders.at(i);
+        if (border - chunkBegin < chunkSize) {
+            continue;
+        }
+        if (documentSize() - border < Chunk_MinSize / 2) {
+            // Not worth it
+            break;
+        }
+
+        // The warm-up start at an earlier border, but behind the begin of the chunk in front
+        int warmUp = i - 1;
+        while (warmUp > 0 && border - borders.at(warmUp) < Chunk_WarmUpSize && borders.at(warmUp - 1) > chunkBegin) {
+            --warmUp;
+        }
+        if (borders.at(warmUp) <= chunkBegin) {
+            continue;
+        }
+
+        ChunkRun run;
+        run.warmUpLine = borders.at(warmUp);
+        run.beginLine = border;
+        p_chunkRuns.append(run);
+        p_chunkLines << run.warmUpLine << run.beginLine;
+        chunkBegin = border;
+    }
+
+    for (int i = 0; i < p_chunkRuns.size(); ++i) {
+        ChunkRun &run = p_chunkRuns[i];
+        const int endLine = i + 1 < p_chunkRuns.size() ? p_chunkRuns.at(i + 1).beginLine : documentSize();
+        // Creating a parser is not cheap, with all its options, icons and model, so these
+        // are kept for the next run. Their result is freed by finishParse()
+        if (i == p_chunkParsers.size()) {
+            p_chunkParsers.append(create(p_document, p_docType, this));
+        }
+        Parser *parser = p_chunkParsers.at(i);
+        parser->prepareChunkRun(this, run.warmUpLine, run.beginLine, endLine);
+        run.parser = parser;
+        run.future = QtConcurrent::run([parser]() {
+            parser->parseDocument();
+        });
+    }
+}
+
+
+void Parser::prepareChunkRun(Parser *master, int warmUpLine, int beginLine, int endLine)
+{
+    // Our view options are in the state parse() has left these of our master
+    const QList<QAction *> options = p_menu.actions();
+    for (QAction *option : options) {
+        QAction *masterOption = option->objectName().isEmpty() ? nullptr : master->p_menu.findChild<QAction *>(option->objectName());
+        if (!masterOption) {
+            continue;
+        }
+        option->blockSignals(true);
+        option->setChecked(masterOption->isChecked());
+        option->setEnabled(masterOption->isEnabled());
+        option->setVisible(masterOption->isVisible());
+        option->blockSignals(false);
+    }
+    takeOptionSnapshot();
+
+    p_lines = master->p_lines;
+    p_cancelParse.storeRelaxed(0);
+    p_foreignLookup = false;
+    p_missedScopes.clear();
+    p_chunkBegin = beginLine;
+    p_chunkEnd = endLine;
+    p_chunkLines = master->p_chunkLines;
+
+    clearResult();
+    prepareForParse();
+
+    p_lineNumber = warmUpLine;
+    p_nextCheckpoint = warmUpLine;
+}
+
+
+void Parser::stopChunkRuns()
+{
+    for (const ChunkRun &run : std::as_const(p_chunkRuns)) {
+        run.parser->p_cancelParse.storeRelaxed(1);
+    }
+
+    waitForChunkRuns();
+}
+
+
+void Parser::waitForChunkRuns()
+{
+    for (const ChunkRun &run : std::as_const(p_chunkRuns)) {
+        QFuture<void> future = run.future;
+        future.waitForFinished();
+    }
+}
+
+
+void Parser::writeReport(QTextStream &stream)
+{
+    stream << "Status Report" << Qt::endl
+           << "===============" << Qt::endl
+           << "Parser        : " << metaObject()->className() << Qt::endl
+           << "Parser Version: " << version() << Qt::endl
+           << "Test File     : KatePlugin-IndexView/tests/" << document()->url().fileName() << Qt::endl
+           << "File CheckSum : " << document()->checksum().toHex() << Qt::endl
+           << Qt::endl
+           << "WARNING! The CheckSum equals the file on disk! Before you commit a changed" << Qt::endl
+           << "         report, reload (F5) the Test File to be save!" << Qt::endl
+           << Qt::endl << Qt::endl
+           << "View Options" << Qt::endl
+           << "--------------" << Qt::endl
+           << "Needless to say, but CHANGES HERE affect the result THERE!" << Qt::endl
+           << "So, something should only change here if options are added or removed." << Qt::endl
+           << "In any other case adjust the view options and trigger a new parsing." << Qt::endl
+           << Qt::endl;
+    for (QAction *action : contextMenu()->actions()) {
+        if (action->isSeparator()) {
+            continue;
+        }
+        stream << qSetFieldWidth(38) << Qt::right
+               << action->text()
+               << qSetFieldWidth(0) << Qt::left
+               << QLatin1StringView(" : ") + QLatin1StringView(action->isChecked() ? "yes" : "no")
+               << Qt::endl;
+    }
+
+    stream << Qt::endl << Qt::endl << qSetFieldWidth(0) << Qt::left
+           << "List of Nodes" << Qt::endl
+           << "---------------" << Qt::endl;
+    const QList<int> &listedNodes = p_indexModel->listedNodes();
+    for (const int node : listedNodes) {
+        stream << qSetFieldWidth(80) << Qt::center << p_indexModel->text(node) << qSetFieldWidth(0) << Qt::endl;
+    }
+
+    stream << qSetFieldWidth(0) << Qt::endl << Qt::endl << Qt::left
+           << "List of Nodes with line numbers" << Qt::endl
+           << "---------------------------------" << Qt::endl
+           << qSetFieldWidth(6) << Qt::left << "Node" << qSetFieldWidth(50) << "Node-Text" << qSetFieldWidth(0) << "Line Column EndLine" << Qt::endl;
+    for (int i = 0; i < listedNodes.size(); ++i) {
+        const int node = listedNodes.at(i);
+        stream << qSetFieldWidth(4) << Qt::right << i << qSetFieldWidth(2) << " "
+               << qSetFieldWidth(50) << Qt::left << p_indexModel->text(node)
+               << qSetFieldWidth(4) << Qt::right << p_indexModel->line(node)
+               << qSetFieldWidth(5) << p_indexModel->column(node)
+               << qSetFieldWidth(7) << p_indexModel->endLine(node) << Qt::endl;
+    }
+}
+
+
+#ifndef GENERATE_REPORT
+// Status Report generation can be enabled by CMake switch -DREPORT=1
+// or manually here by changing the 0 to 1
+#define GENERATE_REPORT 0
+#endif
+#if GENERATE_REPORT>0
+#include <QFile>
+#include <QFileInfo>
+void Parser::generateReport()
+{
+    QString filePath = document()->url().adjusted(QUrl::RemoveFilename).path();
+
+    if (filePath.endsWith(QLatin1StringView("/KatePlugin-IndexView/tests/"))) {
+        qDebug() << "Update Status Report for file " << filePath + document()->url().fileName();
+        QFile file(filePath + QLatin1StringView("reports/") + document()->url().fileName() + QLatin1StringView(".txt"));
+        if (file.open(QIODevice::WriteOnly)) {
+            QTextStream stream(&file);
+            writeReport(stream);
+        }
+    }
+}
+#else
+void Parser::generateReport()
+{
+    // Nothing todo! Guess the compiler will remove the entire call in this case
+    return;
+}
+#endif
+
+
+QString Parser::resultCacheKey()
+{
+    // The checksum belongs to the file on disk, not to the text we would parse
+    if (!m_useResultCache || !p_resultCacheEnabled || p_document->isModified() || p_document->url().isEmpty()) {
+        return QString();
+    }
+
+    const QByteArray checksum = p_document->checksum();
+    if (checksum.isEmpty()) {
+        return QString();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(checksum);
+    hash.addData(QByteArray(metaObject()->className()));
+    hash.addData(version().toUtf8());
+    // Not each change of a parser bump its version, see CMakeLists.txt
+    hash.addData(QByteArrayView(__DATE__ " " __TIME__));
+    hash.addData(p_docType.toUtf8());
+    for (QAction *action : p_menu.actions()) {
+        if (action->isSeparator()) {
+            continue;
+        }
+        hash.addData(action->objectName().toUtf8());
+        hash.addData(action->isChecked() ? QByteArrayView("1") : QByteArrayView("0"));
+    }
+
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+
+QString Parser::resultCacheFile() const
+{
+    // Only one file for each document, so that outdated results don't pile up
+    const QByteArray name = QCryptographicHash::hash(p_document->url().toEncoded(), QCryptographicHash::Sha1).toHex();
+
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/indexview/") + QString::fromLatin1(name);
+}
+
+
+// Increment this when the content of the result cache change
+static const qint32 ResultCacheFormat = 3;
+
+
+bool Parser::loadCachedResult()
+{
+    if (p_resultCacheKey.isEmpty()) {
+        return false;
+    }
+
+    QFile file(p_resultCacheFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    qint32 format;
+    QString key;
+    in >> format;
+    if (format != ResultCacheFormat) {
+        return false;
+    }
+    in >> key;
+    if (key != p_resultCacheKey) {
+        return false;
+    }
+
+    qint32 nodeCount;
+    in >> nodeCount;
+    QList<IndexNode> nodes;
+    nodes.reserve(qMax(0, nodeCount));
+    for (int i = 0; i < nodeCount && in.status() == QDataStream::Ok; ++i) {
+        IndexNode node;
+        in >> node.text >> node.type >> node.iconType >> node.line >> node.column >> node.endLine >> node.parent;
+        in >> node.hidden >> node.expanded >> node.listed;
+        nodes.append(node);
+    }
+
+    QList<int> topLevelNodes;
+    QSet<int> usefulNodeTypes;
+    qint32 maxNesting;
+    bool rootIsDecorated;
+    in >> topLevelNodes >> usefulNodeTypes >> maxNesting >> rootIsDecorated;
+    if (in.status() != QDataStream::Ok) {
+        qDebug() << "FATAL Parser::loadCachedResult: Broken file" << file.fileName();
+        return false;
+    }
+
+    p_nodes = nodes;
+    p_topLevelNodes = topLevelNodes;
+    p_usefulNodeTypes = usefulNodeTypes;
+    p_maxNesting = maxNesting;
+    p_rootIsDecorated = rootIsDecorated;
+
+    // Whatever prepareForParse() has added is part of the cached result
+    p_lastNode = NoNode;
+    p_rootNodes.clear();
+
+    return true;
+}
+
+
+void Parser::saveCachedResult()
+{
+    // Only copies are written, so the next run can go on with the nodes meanwhile
+    const QString fileName = p_resultCacheFile;
+    const QString key = p_resultCacheKey;
+    const QList<IndexNode> nodes = p_nodes;
+    const QList<int> topLevelNodes = p_topLevelNodes;
+    const QSet<int> usefulNodeTypes = p_usefulNodeTypes;
+    const qint32 maxNesting = p_maxNesting;
+    const bool rootIsDecorated = p_rootIsDecorated;
+
+    QThreadPool::globalInstance()->start([fileName, key, nodes, topLevelNodes, usefulNodeTypes, maxNesting, rootIsDecorated]() {
+        QDir().mkpath(QFileInfo(fileName).absolutePath());
+
+        QSaveFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qDebug() << "FATAL Parser::saveCachedResult: Can't write" << fileName;
+            return;
+        }
+
+        QDataStream out(&file);
+        out << ResultCacheFormat << key;
+
+        out << qint32(nodes.size());
+        for (const IndexNode &node : nodes) {
+            out << node.text << node.type << node.iconType << node.line << node.column << node.endLine << node.parent;
+            out << node.hidden << node.expanded << node.listed;
+        }
+
+        out << topLevelNodes << usefulNodeTypes << maxNesting << rootIsDecorated;
+
+        file.commit();
+    });
+}
+
+
+void Parser::docNeedParsing()
+{
+    p_docNeedParsing = true;
+
+    if (isParsing()) {
+        p_cancelParse.storeRelaxed(1);
+        for (const ChunkRun &run : std::as_const(p_chunkRuns)) {
+            run.parser->p_cancelParse.storeRelaxed(1);
+        }
+    }
+}
+
+
+void Parser::dropCanceledParse()
+{
+    if (p_resuming) {
+        // The edited lines of the snapshot are not done yet, and the run before is still
+        // the one the checkpoints belong to
+        const int tail = qMax(0, documentSize() - p_cleanLine);
+        if (p_editedBegin < 0) {
+            p_editedBegin = p_editBegin;
+            p_uneditedTail = tail;
+        } else {
+            p_editedBegin = qMin(p_editedBegin, p_editBegin);
+            p_uneditedTail = qMin(p_uneditedTail, tail);
+        }
+        p_nodes = p_previousRun.nodes;
+        p_journal = p_previousRun.journal;
+        p_checkpoints = p_previousRun.checkpoints;
+    } else {
+        p_fullParseNeeded = true;
+    }
+
+    p_lines.clear();
+    p_previousRun = PreviousRun();
+    p_mappedNodes.clear();
+    p_resuming = false;
+    p_resultCacheKey.clear();
+    p_resultFromCache = false;
+    p_parsingIsRunning = false;
+
+    // The index tree still show the run before, no need to tell anybody
+    if (p_restartParse) {
+        parse();
+    }
+}
+
+
+void Parser::parse()
+{
+    if (!needsUpdate()) {
+        // I'm stubborn and don't want unneeded CPU waste
+        return;
+    }
+
+    if (isParsing()) {
+        // Don't do stupid stuff! We may crash! The running one is canceled and we start again when it gave up
+        p_restartParse = true;
+        return;
+    }
+
+    p_docNeedParsing = false;
+    p_parsingIsRunning = true;
+    p_cancelParse.storeRelaxed(0);
+    p_restartParse = false;
+    p_parseTimer.start();
+
+    const int resumeIndex = resumePoint();
+    p_resuming = resumeIndex > -1;
+    p_lastRunResumed = p_resuming;
+    if (p_resuming) {
+        // Keep the old result, the worker will restore the checkpoint and compare against it
+        p_previousRun.nodes = p_nodes;
+        p_previousRun.journal = p_journal;
+        p_previousRun.checkpoints = p_checkpoints;
+        p_previousRun.documentSize = p_parsedDocumentSize;
+    }
+    p_fullParseNeeded = false;
+
+    clearResult();
+
+    // Make all options visible because "not visible" is treated by Qt as "not enabled"
+    for (auto it = p_nodeTypes.constBegin(); it != p_nodeTypes.constEnd(); ++it) {
+        if (it.value().option) {
+            it.value().option->setVisible(true);
+        }
+    }
+
+    if (p_nesting1) {
+        p_nesting1->setVisible(true);
+        p_nesting2->setVisible(true);
+        p_nesting3->setVisible(true);
+        p_nesting4->setVisible(true);
+    }
+
+    // Enable (or not) view options with respect of their dependencies
+    for (int i = 0; i < p_modifierOptions.size(); ++i) {
+        p_modifierOptions.at(i).dDent->setEnabled(p_modifierOptions.at(i).dDency->isChecked() && p_modifierOptions.at(i).dDency->isEnabled());
+    }
+
+    // The worker only sees this copy, so the user can go on with editing while we parse
+    p_lines.take(p_document->text());
+
+    if (p_resuming) {
+        p_lineDelta = documentSize() - p_previousRun.documentSize;
+        p_editBegin = p_editedBegin;
+        p_cleanLine = qMax(documentSize() - p_uneditedTail, p_editedBegin + 1);
+        p_previousRun.cleanLine = p_cleanLine - p_lineDelta;
+    }
+    // From now on are edits related to this snapshot
+    p_editedBegin = -1;
+
+    takeOptionSnapshot();
+    prepareForParse();
+
+    // An unchanged document may already be parsed in an earlier session
+    p_resultCacheKey = p_resuming ? QString() : resultCacheKey();
+    p_resultCacheFile = p_resultCacheKey.isEmpty() ? QString() : resultCacheFile();
+    p_resultFromCache = false;
+
+    startChunkRuns();
+
+    p_parseWatcher.setFuture(QtConcurrent::run([this, resumeIndex]() {
+        // Reading all nodes takes its time with big documents, so it's done here too
+        if (loadCachedResult()) {
+            p_resultFromCache = true;
+            stopChunkRuns();
+            return;
+        }
+        if (scanGitConflicts()) {
+            // Nothing else is shown, there is no need to parse the document
+            stopChunkRuns();
+            return;
+        }
+        if (resumeIndex > -1) {
+            restoreCheckpoint(resumeIndex);
+        }
+        parseDocument();
+        // Chunks we have not taken over are not needed anymore
+        stopChunkRuns();
+    }));
+}
+
+
+void Parser::clearResult()
+{
+    p_gitConflict = false;
+    p_nodes.clear();
+    p_topLevelNodes.clear();
+    clearChildIndex();
+    p_journal.clear();
+    p_checkpoints.clear();
+    p_journalFloor = 0;
+    p_nextCheckpoint = 0;
+
+    p_lastNode = NoNode;
+    p_rootNodes.clear();
+    p_scopeRoots.clear();
+    p_usefulNodeTypes.clear();
+    m_funcAtWork.clear();
+    p_lineNumber = 0;
+}
+
+
+void Parser::finishParse()
+{
+    // The chunk parsers are done, see stopChunkRuns(), free the memory of their result
+    waitForChunkRuns();
+    for (const ChunkRun &run : std::as_const(p_chunkRuns)) {
+        run.parser->clearResult();
+        run.parser->p_lines.clear();
+    }
+    p_chunkRuns.clear();
+    p_chunkLines.clear();
+
+    if (p_cancelParse.loadRelaxed()) {
+        dropCanceledParse();
+        return;
+    }
+
+    // Not needed anymore, free the memory
+    p_parsedDocumentSize = documentSize();
+    p_lines.clear();
+    p_previousRun = PreviousRun();
+    p_mappedNodes.clear();
+    p_resuming = false;
+
+    if (p_resultFromCache) {
+        // There are no checkpoints where the next run could resume
+        p_fullParseNeeded = true;
+        p_resultCacheKey.clear();
+        p_resultFromCache = false;
+        // Says nothing about the cost of a parsing run
+        p_parseTimer.invalidate();
+    }
+
+    if (p_gitConflict) {
+        // The nodes have nothing to do with the checkpoints
+        p_fullParseNeeded = true;
+    }
+
+    if (p_gitConflict != p_gitConflictShown) {
+        // The tree change its meaning, there is nothing worth to keep
+        p_gitConflictShown = p_gitConflict;
+        p_rebuildIndexTree = true;
+    }
+
+    if (p_gitConflict) {
+        p_indexModel->setHeaderText(i18nc("@title:column", ">>>  GIT CONFLICT  <<<"));
+        buildIndexTree();
+        generateReport();
+        for (QTreeView *indexTree : std::as_const(p_indexTrees)) {
+            indexTree->setContextMenuPolicy(Qt::NoContextMenu);
+            indexTree->setRootIsDecorated(0);
+        }
+        p_parsingIsRunning = false;
+        if (p_parseTimer.isValid()) {
+            p_parseCost = p_parseTimer.elapsed();
+        }
+        Q_EMIT parsingDone(this);
+        return;
+    }
+
+    // Keep the context menu free from useless options
+    for (auto it = p_nodeTypes.constBegin(); it != p_nodeTypes.constEnd(); ++it) {
+        if (it.value().option) {
+            it.value().option->setVisible(p_usefulNodeTypes.contains(it.key()));
+        }
+    }
+
+    if (p_nesting1) {
+        p_nesting1->setVisible(p_maxNesting > 0);
+
+        p_nesting2->setVisible(p_maxNesting > 1);
+        p_nesting2->setEnabled(p_nesting1->isChecked() && p_nesting1->isEnabled());
+
+        p_nesting3->setVisible(p_maxNesting > 2);
+        p_nesting3->setEnabled(p_nesting2->isChecked() && p_nesting2->isEnabled());
+
+        p_nesting4->setVisible(p_maxNesting > 3);
+        p_nesting4->setEnabled(p_nesting3->isChecked() && p_nesting3->isEnabled());
+    }
+
+    for (int i = 0; i < p_modifierOptions.size(); ++i) {
+        p_modifierOptions.at(i).dDent->setVisible(p_modifierOptions.at(i).dDency->isVisible());
+    }
+
+    updateDependentOptions();
+
+    if (!p_resultCacheKey.isEmpty()) {
+        saveCachedResult();
+        p_resultCacheKey.clear();
+    }
+
+    p_indexModel->setHeaderText(i18nc("@title:column", "Index"));
+    buildIndexTree();
+    generateReport();
+
+    for (QTreeView *indexTree : std::as_const(p_indexTrees)) {
+        indexTree->setContextMenuPolicy(Qt::CustomContextMenu);
+    }
+
+    p_parsingIsRunning = false;
+    if (p_parseTimer.isValid()) {
+        p_parseCost = p_parseTimer.elapsed();
+    }
+    Q_EMIT parsingDone(this);
+}
+
+
+void Parser::buildIndexTree()
+{
+    const bool asTree = p_viewTree->isChecked() || p_gitConflict;
+
+    QHash<int, QIcon> icons;
+    if (p_addIcons->isChecked()) {
+        for (auto it = p_nodeTypes.constBegin(); it != p_nodeTypes.constEnd(); ++it) {
+            icons.insert(it.key(), it.value().icon);
+        }
+    }
+    p_indexModel->setIcons(icons);
+
+    if (!p_rebuildIndexTree) {
+        // Keep the tree as the user has left it, only new nodes may need to be expanded
+        const QList<int> addedNodes = p_indexModel->updateNodes(wantedNodes(), p_topLevelNodes, asTree);
+        for (QTreeView *indexTree : std::as_const(p_indexTrees)) {
+            if (asTree) {
+                for (const int node : addedNodes) {
+                    if (p_nodes.at(node).expanded) {
+                        indexTree->expand(p_indexModel->indexOf(node));
+                    }
+                }
+            }
+            indexTree->setRootIsDecorated(asTree ? p_rootIsDecorated : 0);
+        }
+        return;
+    }
+
+    p_rebuildIndexTree = false;
+    p_indexModel->setNodes(wantedNodes(), p_topLevelNodes, asTree);
+
+    for (QTreeView *indexTree : std::as_const(p_indexTrees)) {
+        setupIndexTree(indexTree);
+    }
+}
+
+
+QList<IndexNode> Parser::wantedNodes() const
+{
+    QSet<int> unwantedTypes;
+    for (auto it = p_nodeTypes.constBegin(); it != p_nodeTypes.constEnd(); ++it) {
+        const QAction *viewOption = it.value().option;
+        if (viewOption && viewOption->isChecked() && !viewOption->isEnabled()) {
+            unwantedTypes.insert(it.key());
+        }
+    }
+
+    if (unwantedTypes.isEmpty()) {
+        // The usual case, no copy needed
+        return p_nodes;
+    }
+
+    QList<IndexNode> nodes = p_nodes;
+    for (IndexNode &node : nodes) {
+        if (unwantedTypes.contains(node.iconType)) {
+            node.hidden = true;
+            node.listed = false;
+        }
+    }
+
+    return nodes;
+}
+
+
+void Parser::setupIndexTree(QTreeView *indexTree)
+{
+    const bool asTree = p_viewTree->isChecked() || p_gitConflictShown;
+
+    if (showSorted() && !p_gitConflictShown) {
+        indexTree->setSortingEnabled(true);
+        indexTree->sortByColumn(0, sortOrder());
+    } else {
+        indexTree->setSortingEnabled(false);
+    }
+
+    if (!asTree) {
+        indexTree->setRootIsDecorated(0);
+        return;
+    }
+
+    // Expand works only when the model is set to the view
+    for (int i = 0; i < p_nodes.size(); ++i) {
+        if (p_nodes.at(i).expanded) {
+            indexTree->expand(p_indexModel->indexOf(i));
+        }
+    }
+
+    indexTree->setRootIsDecorated(p_gitConflictShown ? 0 : p_rootIsDecorated);
+}
+
+
+Qt::SortOrder Parser::sortOrder() const
+{
+    // A click on the header of any tree sort the shared model for all of them
+    return p_indexTrees.isEmpty() ? p_sortOrder : p_indexTrees.first()->header()->sortIndicatorOrder();
+}
+
+
+QTreeView *Parser::addIndexTree()
+{
+    QTreeView *indexTree = new QTreeView();
+    indexTree->setModel(p_indexModel);
+    indexTree->setFocusPolicy(Qt::NoFocus);
+    indexTree->setLayoutDirection(Qt::LeftToRight);
+    indexTree->setIndentation(10);
+    // All rows show one line of text, so the view need not to ask each one for its size
+    indexTree->setUniformRowHeights(true);
+    indexTree->setContextMenuPolicy(p_gitConflictShown ? Qt::NoContextMenu : Qt::CustomContextMenu);
+
+    setupIndexTree(indexTree);
+    p_indexTrees.append(indexTree);
+
+    return indexTree;
+}
+
+
+void Parser::removeIndexTree(QTreeView *indexTree)
+{
+    if (p_indexTrees.removeOne(indexTree)) {
+        // Keep the sort order for the next one
+        p_sortOrder = indexTree->header()->sortIndicatorOrder();
+        delete indexTree;
+    }
+}
+
+
+void Parser::takeOptionSnapshot()
+{
+    p_checkedOptions.clear();
+    p_activeOptions.clear();
+
+    const QList<QAction *> options = p_menu.actions();
+    for (const QAction *option : options) {
+        if (!option->isChecked()) {
+            continue;
+        }
+        p_checkedOptions.insert(option);
+        if (option->isEnabled()) {
+            p_activeOptions.insert(option);
+        }
+    }
+}
+
+
+bool Parser::nodeTypeIsWanted(int nodeType)
+{
+    QAction *viewOption = p_nodeTypes.value(nodeType).option;
+
+    if (!viewOption) {
+        // Prior was an option mandatory, but now I think this way is better
+        return true;
+    }
+
+    p_usefulNodeTypes.insert(nodeType);
+
+    return optionIsActive(viewOption);
+}
+
+
+void Parser::setNodeProperties(const int node, const int nodeType, const QString &text, const int lineNumber, const int columnNumber/* = 0*/)
+{
+    if (node == NoNode) {
+        return;
+    }
+
+    const int parentNode = p_nodes.at(node).parent;
+    if (optionIsChecked(p_viewExpanded) && parentNode != NoNode && !p_nodes.at(parentNode).expanded) {
+        editNode(parentNode).expanded = true;
+    }
+
+    IndexNode &n = editNode(node);
+
+    // The size of 45 is choosen to fit into the Status Report (sure could be changed..)
+    // but I think no one need such long lines (ok, maybe these who want parameter to see..)
+    const QString newText = text.size() > 45 ? text.first(45) + QStringLiteral("…") : text;
+    if (node < p_childIndexSize && newText != n.text) {
+        clearChildIndex();
+    }
+    n.text = newText;
+
+    n.iconType = nodeType;
+    n.line = lineNumber;
+    n.column = columnNumber;
+    n.endLine = -1; // ATM, we don't know the end line
+
+    if (m_detachedNodeTypes.contains(nodeType)) {
+        n.endLine = lineNumber;
+    } else {
+        p_lastNode = node;
+    }
+
+    p_maxNesting = qMax(p_maxNesting, p_nestingLevel);
+
+    // A node may be set more than once, so both flags must always be given
+    const bool wanted = nodeTypeIsWanted(nodeType) && (p_nestingAllowed >= (p_nestingLevel + p_nestingLevelAdjustment));
+    n.hidden = !wanted;
+    n.listed = wanted;
+}
+
+
+void Parser:: menuActionTriggered()
+{
+    docNeedParsing();
+    p_fullParseNeeded = true;
+    p_rebuildIndexTree = true;
+    // This call may a little fishy, hm...proper may to emit a signal that we need an update
+    parse();
+    p_viewOptionsChanged = true;
+}
+
+
+QAction *Parser::addViewOption(const QString &name, const QString &caption)
+{
+    QAction *viewOption = p_menu.addAction(caption, this, &Parser::menuActionTriggered);
+    viewOption->setCheckable(true);
+
+    // The object name must be unique due to use as config key
+    if (p_menu.findChild<QAction*>(name)) {
+        QString uniqueName;
+        int i = 1;
         do {
             uniqueName = name + QString::number(++i, 10);
         } while (p_menu.findChild<QAction*>(uniqueName));
@@ -830,6 +2230,40 @@ QAction *Parser::registerViewOptionModifier(const int nodeType, const QString &n
 }
 
 
+void Parser::useCommentTags(const int fixmeTodoNode, const int beginNode)
+{
+    using namespace IconCollection;
+    registerViewOption(fixmeTodoNode, FixmeTodoIcon, QStringLiteral("FIXME/TODO"), i18n("Show FIXME/TODO"));
+    registerViewOption(beginNode, BeginIcon, QStringLiteral("BEGIN"), i18n("Show BEGIN"));
+    m_detachedNodeTypes << fixmeTodoNode << beginNode;
+
+    m_commentTags.addTag(QStringLiteral("FIXME"), fixmeTodoNode);
+    m_commentTags.addTag(QStringLiteral("TODO"), fixmeTodoNode);
+    m_commentTags.addTag(QStringLiteral("BEGIN"), beginNode);
+
+    // A chunk parser must have the same node types as its master, no matter what the config say meanwhile
+    QStringList userTags;
+    if (p_chunkMaster) {
+        userTags = p_chunkMaster->m_commentTags.tags();
+    } else {
+        KConfigGroup config(KSharedConfig::openConfig(), QStringLiteral("PluginIndexView"));
+        userTags = config.readEntry(QStringLiteral("CommentTags"), QStringList());
+    }
+    int nodeType = FirstCommentTagNode;
+    for (const QString &userTag : userTags) {
+        const QString tag = userTag.trimmed();
+        if (tag.isEmpty() || m_commentTags.tags().contains(tag)) {
+            continue;
+        }
+        // The name is also the caption of its root node
+        registerViewOption(nodeType, Yellow2Icon, tag, i18n("Show %1", tag));
+        m_detachedNodeTypes << nodeType;
+        m_commentTags.addTag(tag, nodeType);
+        ++nodeType;
+    }
+}
+
+
 void Parser::addViewOptionSeparator()
 {
     p_menu.addSeparator();
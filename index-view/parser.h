@@ -23,18 +23,21 @@
 #define INDEXVIEW_PARSER_CLASS_H
 
 #include <QAction>
+#include <QAtomicInt>
 #include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QMenu>
 #include <QObject>
-#include <QPointer>
 #include <QQueue>
 #include <QString>
-#include <QTreeWidget>
-#include <QTreeWidgetItem>
+#include <QTextStream>
+#include <QTreeView>
 
 #include <KTextEditor/Document>
 
+#include "comment_tag_matcher.h"
 #include "icon_collection.h"
+#include "index_model.h"
 
 
 // FIXME Idea for a better solution?
@@ -49,14 +52,23 @@
 // #define Me_At_Work QLatin1String(__FUNCSIG__)
 // #endif
 
-enum NodeData {
-    Line = Qt::UserRole, // Where the pattern is located
-    Column,              // Where the pattern is located
-    EndLine              // Line number for which the item is still relevant/responsible
-};
-
 class KatePluginIndexView;
 
+/**
+ * Lines between two checkpoints, see Parser::passCheckpoint()
+ */
+static const int Checkpoint_Interval = 512;
+
+/**
+ * Lines a chunk has at least, when a big document is parsed in parallel, see Parser::chunkBorders()
+ */
+static const int Chunk_MinSize = 8192;
+
+/**
+ * Lines a chunk parser runs at least in front of its chunk, to reach there the same state as we do
+ */
+static const int Chunk_WarmUpSize = 256;
+
 /**
  * The @c Parser class must be the base for all @c IndexView parser.
  * However it may not recommended to use this class as a direct parent for new
@@ -67,6 +79,23 @@ class KatePluginIndexView;
  * The @c Parser class do a little more than only to parse the document, it is
  * also some kind of data container and care taker to avoid flicker.
  *
+ * The parsing itself is done in a worker thread on a snapshot of the document
+ * lines, so the editing is never blocked. Therefore must parseDocument() and all
+ * functions called by them never touch any widget or the document, but only work
+ * on the @c IndexNode list by using the node functions like newNode().
+ *
+ * To avoid a full parse after each keystroke, the parser keep track of the edited
+ * lines and remember its state at checkpoints. The next run resume then at the last
+ * checkpoint in front of the edit and stop as soon as it reach a checkpoint behind the
+ * edit with the same state as the previous run, where the rest of the old result is
+ * taken over. A master class which like to offer this has to call passCheckpoint()
+ * and to hand over its own state by saveScanState() and restoreScanState().
+ *
+ * The same is used to parse a big document in parallel. Each chunk behind the first
+ * one is parsed by a parser of our kind, which start a little in front of its chunk.
+ * When we reach the chunk with the same state as the chunk parser had there, its
+ * result is taken over like the one of a previous run, otherwise we go on parsing.
+ *
  * @author loh.tar
  */
 class Parser : public QObject
@@ -132,59 +161,83 @@ public:
     bool isParsing() { return p_parsingIsRunning; };
 
     /**
-     * This function is called by IndexView::docEdited() to hint the parser that
-     * a parsing is needed. Without this call parse() does nothing!
+     * @return how many milliseconds the last finished parsing run took, from parse()
+     * until the index tree was updated, or -1 when there was none
      */
-    void docNeedParsing() { p_docNeedParsing = true; };
+    qint64 parseCost() const { return p_parseCost; };
 
     /**
-     * This function must be used to protect for unneeded parsing, or we are doomed!
-     * HINT: Introduced to never miss an update but also to avoid unneeded parsing after
-     * a document switch.
+     * @return true when the last parsing run has started at a checkpoint of the run
+     * before it, see resumePoint()
      */
-    bool needsUpdate() { return p_docNeedParsing; };
+    bool lastRunResumed() const { return p_lastRunResumed; };
+
+    /**
+     * @return how many chunks the last finished parsing run has taken over from its
+     * chunk parsers, see startChunkRuns()
+     */
+    int chunksTakenOver() const { return p_chunksTakenOver; };
 
     /**
-     * This function return the last parsed tree.
-     * WARNING: Never burn (delete) this tree, Parser take care of him
-     * @return the last updated index tree
+     * Big documents are split into chunks which are parsed in parallel, unless this is
+     * disabled. Used by indexview-cli to compare the result with an unsplit run.
+     * @param enabled is true by default
      */
-    QTreeWidget *indexTree() { return p_indexTree; };
+    void setChunkRunsEnabled(bool enabled) { p_chunkRunsEnabled = enabled; };
 
     /**
-     * This function return the old, outdated index tree which is no longer solid.
-     * WARNING: Never burn (delete) this tree, burnDownMustyTree() take care of him
-     * @return the old, outdated index tree
+     * Results of unmodified documents are kept in a cache on disk, unless this is
+     * disabled. Used by indexview-cli, whose reports must be the work of the parser.
+     * @param enabled is true by default, but can't enable what the parser has disabled
      */
-    QTreeWidget *mustyTree() { return p_mustyTree; };
+    void setResultCacheEnabled(bool enabled) { p_resultCacheEnabled = enabled; };
 
     /**
-     * This function is pretty important! Must be called after all updates are done
-     * and will not only remove old wood but also ensure the tree keep the old scroll
-     * position.
+     * This function is called by IndexView::docEdited() to hint the parser that
+     * a parsing is needed. Without this call parse() does nothing!
+     * A running parsing is canceled, its result would be outdated anyway.
      */
-    void burnDownMustyTree();
+    void docNeedParsing();
 
     /**
-     * @return Filter state of the tree
+     * This function must be used to protect for unneeded parsing, or we are doomed!
+     * HINT: Introduced to never miss an update but also to avoid unneeded parsing after
+     * a document switch.
      */
-    bool treeIsFiltered() { return p_filtered; };
+    bool needsUpdate() { return p_docNeedParsing; };
 
     /**
-     * Set the filter state of the tree
-     * @param filtered true if the tree is filtered
+     * Create a new view of the index, e.g. for one more Kate main window. All trees
+     * show the same model, but each has its own expanded and hidden rows.
+     * WARNING: Never burn (delete) this tree, use removeIndexTree()
+     * @return the new index tree, already up to date with the last parsing run
      */
-    void setTreeFiltered(bool filtered) { p_filtered = filtered; };
+    QTreeView *addIndexTree();
 
     /**
-     * @return the index list
+     * Delete @p indexTree, which was created by addIndexTree()
      */
-    QList<QTreeWidgetItem *> *indexList() { return &p_indexList; };
+    void removeIndexTree(QTreeView *indexTree);
 
     /**
-    * This is the main access function to parse the document. These will call
-    * prepareForParse() and parseDocument(). Before and after that will done
-    * some janitor task like update the context menu to hide unneeded options.
+     * This function return the model of the last parsed tree.
+     * @return the model shown by all index trees
+     */
+    IndexModel *indexModel() { return p_indexModel; };
+
+    /**
+     * Block until a running parsing in the worker thread has returned. This must be
+     * called before a parser is deleted, because the worker may still use members of
+     * a sub class, which are already gone when ~Parser() is reached.
+     */
+    void waitForParsing();
+
+    /**
+    * This is the main access function to parse the document. These will take a
+    * snapshot of the document, call prepareForParse() and start parseDocument()
+    * in a worker thread. When the worker is done is finishParse() called, which
+    * update the index tree and emit parsingDone(). Before and after that will
+    * done some janitor task like update the context menu to hide unneeded options.
     * NOTE: When prior was not called docNeedParsing() nothing is done.
     * Only some master classes may need to implemented an own
     * version to init some special variables or to do other special treatment.
@@ -212,10 +265,17 @@ public:
      */
     bool showAsTree() { return p_viewTree->isChecked(); }
 
+    /**
+     * Write the Status Report of the last parsing run to @p stream, that is the view
+     * options and the listed nodes, as found in tests/reports.
+     * @see generateReport()
+     */
+    void writeReport(QTextStream &stream);
+
 Q_SIGNALS:
     /**
-     * Since we parse in time slices, we need to inform the IndexView that we are
-     * done.
+     * Since we parse in a worker thread, we need to inform the IndexView that we are
+     * done and the updated index tree is ready to use.
      */
     void parsingDone(Parser *parser);
 
@@ -233,6 +293,17 @@ protected:
         ZeroNodeType
     };
 
+    /**
+     * Used as node number to indicate there is no node, like nullptr for a pointer.
+     */
+    static const int NoNode = -1;
+
+    /**
+     * The node type of the first user configured comment tag, far behind these of
+     * any parser, see useCommentTags()
+     */
+    static const int FirstCommentTagNode = 1000;
+
     /**
      * This function increment with each call the index @c p_lineNumber to access
      * the document lines. There is very rare a need to use this function. They
@@ -248,14 +319,18 @@ protected:
     * @param offset is added to @c p_lineNumber to index the line of the document
     * @return the current line from the document indexed by @c p_lineNumber + @p offset.
     * If the result is less 0 or bigger than documentSize(), an empty string is returned.
+    * @note The returned view is only valid while the parsing is running
     */
-    QString rawLine(int offset = 0) const;
+    QStringView rawLine(int offset = 0) const;
+
+    /**
+     * @return the number of lines of the document snapshot we work on
+     */
+    int documentSize() const { return p_lines.size(); }
 
     /**
     * This function iterate with each call over the document and append the line
     * which is indexed by @c p_lineNumber to @c m_line.
-    * This function also checks @c m_runTime and calls qApp->processEvents() if too
-    * much time is gone to keep the editing responsive.
     * @return false when no line was left
     */
     virtual bool appendNextLine();
@@ -265,8 +340,92 @@ protected:
      */
     int lineNumber() const { return p_lineNumber - 1; }
 
+    /**
+    * Call this function in a master class each time before the next instruction or
+    * similar is read, where the scan state is complete and nothing is pending. Every
+    * @c Checkpoint_Interval lines is then the state saved, so that a later run can
+    * resume there. When we run again and the state match the one of the previous run
+    * at the same place behind the edited lines, the rest of the old result is taken
+    * over. Without any call is the whole document parsed each time.
+    * @note The call must be done also when the end of the document is reached
+    * @return true when the old result was taken over and there is nothing more to
+    * parse, the master class must then behave as if the end of the document was reached
+    */
+    bool passCheckpoint();
+
+    /**
+     * The @c ScanState hold these members of a master class at a checkpoint, which
+     * are needed to go on parsing from there, like a nesting stack. Node and line
+     * numbers are kept apart from other values, because they must be translated when
+     * the state of a previous run is compared or taken over. The values are read back
+     * in the same order as they were added.
+     * @see saveScanState(), restoreScanState()
+     */
+    class ScanState
+    {
+    public:
+        void addNode(const int node) { p_nodes.append(node); }
+        void addLine(const int lineNumber) { p_lines.append(lineNumber); }
+        void addValue(const int value) { p_values.append(value); }
+        void addText(const QString &text) { p_texts.append(text); }
+
+        int takeNode() { return p_nodes.value(p_nodesRead++, NoNode); }
+        int takeLine() { return p_lines.value(p_linesRead++, -1); }
+        int takeValue() { return p_values.value(p_valuesRead++, 0); }
+        QString takeText() { return p_texts.value(p_textsRead++); }
+
+        bool operator==(const ScanState &other) const
+        {
+            return p_values == other.p_values && p_texts == other.p_texts
+                && p_nodes == other.p_nodes && p_lines == other.p_lines;
+        }
+        bool operator!=(const ScanState &other) const { return !(*this == other); }
+
+    private:
+        friend class Parser;
+
+        QList<int>      p_nodes;
+        QList<int>      p_lines;
+        QList<int>      p_values;
+        QStringList     p_texts;
+        int             p_nodesRead = 0;
+        int             p_linesRead = 0;
+        int             p_valuesRead = 0;
+        int             p_textsRead = 0;
+    };
+
+    /**
+    * A master class which call passCheckpoint() must re-implement this function to add
+    * all its members to @p state, which are not already known by Parser and are needed
+    * to go on parsing from the current line. The same may a parser do which keep some
+    * state of its own. Ensure to call the function of the base class first.
+    * @note This function runs in a worker thread, see class description
+    */
+    virtual void saveScanState(ScanState &state) const;
+
+    /**
+    * The counterpart to saveScanState(), take all values back in the same order as they
+    * were added and call the function of the base class first. Called in front of
+    * parseDocument() when the parsing resume at a checkpoint, and when the rest of
+    * the previous run is taken over.
+    * @note This function runs in a worker thread, see class description
+    */
+    virtual void restoreScanState(ScanState &state);
+
+    /**
+    * A master class which call passCheckpoint() may re-implement this function to allow
+    * a parallel parse of big documents. It should do only a quick scan for lines where a
+    * new top level instruction likely begin, like a not indented line outside of any
+    * block. A wrong guess costs only time, the result is still the one of a normal run.
+    * @note The lines must be these where passCheckpoint() is called, so empty lines in
+    * front of an instruction belong to the border
+    * @return the lines in ascending order, by default none so the document is parsed as whole
+    */
+    virtual QList<int> chunkBorders() const { return QList<int>(); }
+
     /**
     * This is the beef and must be implemented by each derivated parser class.
+    * @note This function runs in a worker thread, see class description
     */
     virtual void parseDocument() = 0;
 
@@ -275,16 +434,64 @@ protected:
     * the possibilities to do some initialization in a master class after the
     * janitor initialization task is done, like clear the tree. By default there
     * will be only the root decoration set according to checked @c p_viewTree.
+    * Unlike parseDocument() is this function called in the GUI thread.
     */
     virtual void prepareForParse();
 
+    /**
+    * This function is called in the GUI thread when parseDocument() is done. They
+    * update the index tree with the collected nodes, update the context menu
+    * and emit parsingDone(). A master class may re-implement this function to do
+    * some final treatment, but must call Parser::finishParse() at some point.
+    * NOTE: A canceled parsing end here too, but the collected nodes are dropped
+    */
+    virtual void finishParse();
+
+    /**
+    * This function is called by finishParse() when it is known which view options
+    * are useful and the context menu shows only these. A master class may here
+    * enable or disable options which depend on others. Nodes of an option which
+    * is now disabled are not shown, without to parse the document again.
+    */
+    virtual void updateDependentOptions() {};
+
+    /**
+     * Set the root decoration of the index tree, which is applied when the tree
+     * is build by finishParse()
+     */
+    void setRootIsDecorated(bool show) { p_rootIsDecorated = show; };
+
     /**
      * This function return the root node of the given @p nodeType holded in @c p_rootNodes.
      * If such node not exist, is a new node created, added to @c p_rootNodes and returned.
      * @param nodeType of type NodeType
      * @return root node of asked type
      */
-    QTreeWidgetItem *rootNode(int nodeType);
+    int rootNode(int nodeType);
+
+    /**
+     * @return the name of @p nodeType, which is the text of its root node
+     */
+    virtual QString nodeTypeName(int nodeType) const { return p_nodeTypes.value(nodeType).name; };
+
+    /**
+     * Like rootNode(), but no new node is created.
+     * @return root node of asked type or NoNode
+     */
+    int existingRootNode(int nodeType);
+
+    /**
+     * Some master classes collect nodes by the scope they belong to, like the member
+     * functions of a C++ class which are defined outside of it. The node which hold
+     * them is kept here, so that each checkpoint and chunk run know it too.
+     * @return the node of @p scope or NoNode when there is none yet
+     */
+    int scopeRoot(const QString &scope);
+
+    /**
+     * Keep @p node as the node of @p scope, see scopeRoot()
+     */
+    void setScopeRoot(const QString &scope, int node) { p_scopeRoots.insert(scope, node); };
 
     /**
      * This function checks first if given @p nodeType is holded in @c m_detachedNodeTypes.
@@ -294,9 +501,9 @@ protected:
      * @param text the caption of the new node, visible in the view
      * @param lineNumber the line where the pattern is located in the file
      * @param columnNumber the column where the pattern is located in the file
-     * @return new added node or nullptr
+     * @return new added node or NoNode
      */
-    QTreeWidgetItem *addDetachedNode(int nodeType, const QString &text, const int lineNumber, const int columnNumber = 0);
+    int addDetachedNode(int nodeType, const QString &text, const int lineNumber, const int columnNumber = 0);
 
     /**
      * Call this function in an ctor of a (master) class to add nesting options to the context menu.
@@ -338,8 +545,8 @@ protected:
     /**
     * Add a new view option to the context menu to modify the look of some node,
     * e.g. "Show Parameter"
-    * @note As opposed to registerViewOption() should you store and use the returned
-    *       QAction later in parseDocument().
+    * @note As opposed to registerViewOption() should you store the returned QAction
+    *       and ask optionIsChecked() about it later in parseDocument().
     * @param nodeType is the option to modify
     * @param name is used to store the setting, therefore don't translate this
     * @param caption is visible in the menu and should be translated
@@ -347,6 +554,15 @@ protected:
     */
     QAction *registerViewOptionModifier(const int nodeType, const QString &name, const QString &caption);
 
+    /**
+    * Register the view options of the FIXME/TODO and BEGIN comment tags, and of
+    * each tag the user has configured, which get its own detached node type
+    * counted from @c FirstCommentTagNode. All these tags are added to @c m_commentTags.
+    * @param fixmeTodoNode is the node type of the sub class for FIXME and TODO
+    * @param beginNode is the node type of the sub class for BEGIN
+    */
+    void useCommentTags(const int fixmeTodoNode, const int beginNode);
+
     /**
     * Add a new view option to the context menu to modify the general look of the
     * displayed index view, e.g. "Show Sorted". This function should only be used
@@ -390,12 +606,36 @@ protected:
     /**
     * You can call this function at the beginning of addNode() to test if you must go on.
     * @note This function ensures that a "not enabled" option is treated as "not checked"
-    *       and that @c p_usefulOptions is filled. It's also called in setNodeProperties()
+    *       and that @c p_usefulNodeTypes is filled. It's also called in setNodeProperties()
     * @param nodeType the type of the new node, like header or paragraph
     * @return false when @p nodeType is not wanted to show.
     */
     bool nodeTypeIsWanted(int nodeType);
 
+    /**
+    * Remember which view options are checked and enabled, so that parseDocument()
+    * can ask optionIsChecked() and optionIsActive() without to touch the QActions
+    * from its worker thread. It's called by parse() right before prepareForParse(),
+    * call it again when prepareForParse() change the options.
+    */
+    void takeOptionSnapshot();
+
+    /**
+    * @return true when @p option was checked as takeOptionSnapshot() was called.
+    * Use this in parseDocument() instead of QAction::isChecked()
+    */
+    bool optionIsChecked(const QAction *option) const { return p_checkedOptions.contains(option); };
+
+    /**
+    * @return true when @p option was checked and enabled as takeOptionSnapshot() was called
+    */
+    bool optionIsActive(const QAction *option) const { return p_activeOptions.contains(option); };
+
+    /**
+    * @return showAsTree() as it was when the parsing run started
+    */
+    bool parseAsTree() const { return optionIsChecked(p_viewTree); };
+
     /**
     * Call this function at the end of addNode() to set the data of the new node.
     * This function ensures also to expand the nodes dependent on @c p_viewExpanded.
@@ -404,12 +644,50 @@ protected:
     * @param text the caption of the new node, visible in the view
     * @param lineNumber the line where the pattern is located in the file
     */
-    void setNodeProperties(QTreeWidgetItem *const node, const int nodeType, const QString &text, const int lineNumber, const int columnNumber = 0);
+    void setNodeProperties(const int node, const int nodeType, const QString &text, const int lineNumber, const int columnNumber = 0);
 
     /**
      * @return the last added node, which is p_lastNode
      */
-    QTreeWidgetItem *lastNode() const { return p_lastNode; }
+    int lastNode() const { return p_lastNode; }
+
+    /**
+     * Add a new, still empty, node to the tree. Use setNodeProperties() to fill them.
+     * @param parentNode where to add the new node, or NoNode to add a top level node
+     * @param nodeType the type of the new node
+     * @return the new added node
+     */
+    int newNode(const int parentNode, const int nodeType);
+
+    /**
+     * Remove the given @p node from the tree. The node must not have any children.
+     */
+    void removeNode(const int node);
+
+    /**
+     * Search below @p parentNode for a node with the caption of @p text. When there
+     * are more than one, the first one is found. It's looked up in a hash, so it
+     * doesn't matter how many children there are.
+     * @return the found node or NoNode
+     */
+    int findChild(const int parentNode, const QString &text);
+
+    /**
+     * @return the number of nodes directly below @p node
+     */
+    int childCount(const int node) const;
+
+    int nodeTypeOf(const int node) const { return p_nodes.at(node).type; }
+    int nodeParent(const int node) const { return p_nodes.at(node).parent; }
+    int nodeEndLine(const int node) const { return p_nodes.at(node).endLine; }
+    QString nodeText(const int node) const { return p_nodes.at(node).text; }
+    bool nodeIsListed(const int node) const { return p_nodes.at(node).listed; }
+    int nodeCount() const { return p_nodes.size(); }
+
+    void setNodeText(const int node, const QString &text) { editNode(node).text = text; }
+    void setNodeLine(const int node, const int lineNumber) { editNode(node).line = lineNumber; }
+    void setNodeEndLine(const int node, const int lineNumber) { if (nodeEndLine(node) != lineNumber) editNode(node).endLine = lineNumber; }
+    void setNodeHidden(const int node, const bool hidden) { editNode(node).hidden = hidden; }
 
     /**
      * Use this set of flags to indicate a changed state in some function.
@@ -433,17 +711,211 @@ protected:
     QSet<int>                       m_detachedNodeTypes;
 
     /**
-     * Measure the gone parse time. Started in parse() and checked in appendNextLine()
-     * to call qApp->processEvents() to keep the editing responsive.
+     * The comment tags to look for, filled by useCommentTags()
      */
-    QElapsedTimer                   m_runTime;
+    CommentTagMatcher               m_commentTags;
+
+    /**
+     * Set this to false in the ctor when the result of your parser can't be restored
+     * from the result cache, e.g. because node types are created while parsing.
+     */
+    bool                            m_useResultCache = true;
 
 private:
     /**
-     * This function is only called by Parser::parse
+     * Each change of a node which is older than the last checkpoint must be done by using
+     * this function, so that the change can be undone when we resume at that checkpoint.
+     * @return the node ready to be modified
+     */
+    IndexNode &editNode(const int node);
+
+    /**
+     * This function is called when the document is edited and record the affected
+     * lines. It is only valid to call this right after the edit was done.
+     * @param firstLine is the first edited line
+     * @param lastLine is the last edited line, as it is now after the edit
+     */
+    void markLinesEdited(int firstLine, int lastLine);
+
+    /**
+     * @return the index of the checkpoint in @c p_checkpoints where the next run can resume,
+     * or -1 when a full parse is needed
+     */
+    int resumePoint() const;
+
+    /**
+     * Save the current state as new checkpoint
+     */
+    void saveCheckpoint();
+
+    /**
+     * Restore the state of checkpoint @p index of the previous run. Only called by
+     * the worker thread in front of parseDocument().
+     */
+    void restoreCheckpoint(int index);
+
+    /**
+     * Called by passCheckpoint() when we are behind the edited lines and at the place of
+     * an old checkpoint. When the state match, the rest of the old result is appended.
+     * @return true when the old result was taken over
+     */
+    bool takeOverPreviousRun();
+
+    /**
+     * Append the rest of the result of @c p_previousRun behind its checkpoint @p match,
+     * which state is the same as ours. Used by takeOverPreviousRun() and takeOverChunk()
+     * @return false when some of the result has no counterpart in our run
+     */
+    bool adoptPreviousRun(int match);
+
+    /**
+     * Translate a node number of the previous run to the current one. Nodes in front of
+     * the resume point are the same, nodes behind the matching checkpoint are shifted.
+     * Nodes in between must have an equal counterpart at the same distance to the end.
+     * @return the node number in the current run, NoNode or Unmappable
+     */
+    int mapNode(int oldNode);
+
+    /**
+     * Translate a line number of the previous run to the current document.
+     * @return the new line number or Unmappable when the line was edited
+     */
+    int mapLine(int oldLine) const;
+
+    /**
+     * Translate all node and line numbers of the old @p state to the current run.
+     * @return false when some of them has no counterpart
+     */
+    bool translateScanState(ScanState &state);
+
+    /**
+     * @return the old @p node as it was at the old checkpoint @p index
+     */
+    IndexNode previousNode(int index, int node) const;
+
+    /**
+     * @return true when the @p oldNode of the previous run is translated the same as our @p node
+     */
+    bool equalNode(const IndexNode &oldNode, const IndexNode &node);
+
+    /**
+     * Forget the result of the last run, called in front of a new one
+     */
+    void clearResult();
+
+    /**
+     * Move the root @p node of a detached node type, which must be the last top level
+     * node, to its place on top of the view
+     */
+    void sortInDetachedRoot(const int node);
+
+    struct ChunkRun;
+
+    /**
+     * Called by parse() in front of the worker. When the document is big enough and the
+     * master class offer chunkBorders(), are the chunks behind the first one parsed by
+     * parallel runs of our chunk parsers, the first chunk is ours.
+     */
+    void startChunkRuns();
+
+    /**
+     * Called by startChunkRuns() on a chunk parser, which then parse the snapshot of
+     * @p master with the same view options from @p warmUpLine until @p endLine
+     */
+    void prepareChunkRun(Parser *master, int warmUpLine, int beginLine, int endLine);
+
+    /**
+     * Called by passCheckpoint(). When we are at the begin of the next chunk, and its
+     * chunk parser had there the same state as we have now, is its result taken over.
+     * @return true when the end of the document was reached by doing so
+     */
+    bool takeOverChunks();
+
+    /**
+     * Compare our state and the nodes we added since the warm-up line of @p run with these
+     * of its chunk parser, and take over its result when all is the same
+     * @return true when the result was taken over
+     */
+    bool takeOverChunk(const ChunkRun &run);
+
+    /**
+     * Cancel the chunk runs and wait for them, called by the worker before it is done
+     */
+    void stopChunkRuns();
+
+    /**
+     * Block until all chunk runs have returned
+     */
+    void waitForChunkRuns();
+
+    /**
+     * This function is only called by Parser::finishParse
      */
     void generateReport();
 
+    /**
+     * Forget @c p_childIndex, must be called when nodes are removed from
+     * @c p_nodes or replaced, or the text of an indexed node is changed
+     */
+    void clearChildIndex() { p_childIndex.clear(); p_childIndexSize = 0; };
+
+    /**
+     * This function is only called by Parser::finishParse when the parsing was
+     * canceled. The result of the run before is restored, so that the next run can
+     * still resume at its checkpoints, and a pending parse() is started.
+     */
+    void dropCanceledParse();
+
+    /**
+     * The result of a full parsing run of an unmodified document is kept on disk,
+     * one file for each document, so that the next opening of it needs no parsing.
+     * @return the key of the current document content with the current view options,
+     * or an empty string when the result can't be cached
+     */
+    QString resultCacheKey();
+
+    /**
+     * @return the file name where the result of our document is cached
+     */
+    QString resultCacheFile() const;
+
+    /**
+     * Fill the nodes from the result cache when it match @c p_resultCacheKey,
+     * which is done by the worker
+     * @return false when there is no matching result
+     */
+    bool loadCachedResult();
+
+    /**
+     * Write a copy of the current nodes to the result cache under @c p_resultCacheKey,
+     * which is done on the thread pool
+     */
+    void saveCachedResult();
+
+    /**
+     * This function is only called by Parser::finishParse to bring the model of the
+     * index tree up to date with @c p_nodes and to expand new nodes as wanted. After
+     * a change of the view options is the model filled from scratch.
+     */
+    void buildIndexTree();
+
+    /**
+     * @return the nodes as they are given to the model, where nodes of meanwhile
+     * disabled view options are hidden, see updateDependentOptions()
+     */
+    QList<IndexNode> wantedNodes() const;
+
+    /**
+     * Bring @p indexTree in the state the last parsing run has left, which is
+     * needed after the model was filled from scratch or for a new tree.
+     */
+    void setupIndexTree(QTreeView *indexTree);
+
+    /**
+     * @return the current sort order of the index trees
+     */
+    Qt::SortOrder sortOrder() const;
+
     /**
      * This function is only called by Parser::create
      */
@@ -451,30 +923,78 @@ private:
 
     /**
      * This function should be called in a master class function like Parser::appendNextLine()
-     * to fetch the next line of the document and increment @c p_lineNumber. If one occurrence
-     * of a git conflict block is found will something like a reset performed and the rest of
-     * the document parsed. Furthermore will @c p_gitConflict set to true, which may a master class
-     * check to avoid some crash.
+     * to fetch the next line of the document and increment @c p_lineNumber.
      * @warning There is no check of @c p_lineNumber done in normal operation
-     * @return the next line of the document or empty string
+     * @return the next line of the document or empty string when the run is canceled
+     */
+    QStringView nextLineOrBust();
+
+    /**
+     * Called once by the worker in front of parseDocument(). All git conflict blocks of
+     * the document are searched in one pass and added as nodes, in which case
+     * @c p_gitConflict is set and the document itself is not parsed.
+     * @return true when some conflict block was found
+     */
+    bool scanGitConflicts();
+
+    /**
+     * The @c LineSource hold the snapshot of the document as one contiguous text and
+     * hand out each line as a view into that text, so that reading a line does not
+     * need to allocate memory.
      */
-    QString nextLineOrBust();
+    class LineSource
+    {
+    public:
+        /**
+         * Take @p text as new snapshot, where the lines are separated by @c \n
+         */
+        void take(const QString &text);
+        void clear() { p_text.clear(); p_lineStarts.clear(); }
+
+        int size() const { return p_lineStarts.isEmpty() ? 0 : p_lineStarts.size() - 1; }
+
+        /**
+         * @return the line @p lineNumber without the line break, which must be valid
+         */
+        QStringView line(int lineNumber) const
+        {
+            const qsizetype start = p_lineStarts.at(lineNumber);
+            return QStringView(p_text).sliced(start, p_lineStarts.at(lineNumber + 1) - 1 - start);
+        }
+
+    private:
+        QString             p_text;
+        QList<qsizetype>    p_lineStarts;   // With a virtual one behind the last line
+    };
 
     KTextEditor::Document          *p_document; // Our doc where we work on, once set in ctor
     QString                         p_docType;  // The type of p_document, once set in ctor
+    LineSource                      p_lines;    // Snapshot of p_document, taken in parse()
+    QFutureWatcher<void>            p_parseWatcher;
     bool                            p_parsingIsRunning = false;
+    QAtomicInt                      p_cancelParse;          // Set by docNeedParsing(), checked by the worker
+    bool                            p_restartParse = false; // parse() was called while a canceled one was running
+    QElapsedTimer                   p_parseTimer;           // Not valid when the result is taken from the cache
+    qint64                          p_parseCost = -1;
+    bool                            p_lastRunResumed = false;
     bool                            p_docNeedParsing = true;
-    QTreeWidget                    *p_indexTree = nullptr;
-    QPointer<QTreeWidget>           p_mustyTree;
+    QList<QTreeView *>              p_indexTrees;
+    IndexModel                     *p_indexModel = nullptr;
+    Qt::SortOrder                   p_sortOrder = Qt::AscendingOrder; // As loaded, until there is a tree
+    bool                            p_rebuildIndexTree = true;  // Instead of updating the model
+    bool                            p_gitConflictShown = false; // The index tree show the conflicts
+    bool                            p_rootIsDecorated = false;
     bool                            p_gitConflict = false;
-    bool                            p_filtered = false;
-    QList<QTreeWidgetItem *>        p_indexList;
+    QList<IndexNode>                p_nodes;
+    QList<int>                      p_topLevelNodes; // In order of appearance in the tree
     QMenu                           p_menu;
     QAction                        *p_viewSort = nullptr;
     QAction                        *p_viewTree = nullptr;
     QAction                        *p_addIcons = nullptr;
     QAction                        *p_viewExpanded = nullptr;
     bool                            p_viewOptionsChanged = false;
+    QSet<const QAction *>           p_checkedOptions;   // Snapshot of the view options, see takeOptionSnapshot()
+    QSet<const QAction *>           p_activeOptions;    // Those of them which are also enabled
 
     struct NodeTypeStruct {
         NodeTypeStruct() {};
@@ -486,7 +1006,13 @@ private:
     };
     QHash<int, NodeTypeStruct>      p_nodeTypes;
 
-    QHash<int, QTreeWidgetItem*>    p_rootNodes;
+    QHash<int, int>                 p_rootNodes;
+    QHash<QString, int>             p_scopeRoots;   // See scopeRoot()
+
+    // Used by findChild(), the first node for each parent and text, which is extended
+    // by the nodes added since the last call
+    QHash<QPair<int, QString>, int> p_childIndex;
+    int                             p_childIndexSize = 0;   // Nodes in front of it are indexed
 
     struct DependencyPair {
         DependencyPair(QAction *t ,QAction *y) : dDent(t), dDency(y) {};
@@ -495,7 +1021,7 @@ private:
     };
     QList<DependencyPair>           p_modifierOptions;
 
-    QSet<QAction*>                  p_usefulOptions;
+    QSet<int>                       p_usefulNodeTypes;      // Some node was wanted, so the option is useful
     int                             p_lineNumber;           // Counter in appendNextLine()
 
     QAction                        *p_nesting1 = nullptr;
@@ -508,7 +1034,91 @@ private:
     int                             p_maxNesting =  -1;
 
     // No one should change this variable except Parser::parse and Parser::setNodeProperties
-    QTreeWidgetItem                *p_lastNode = nullptr;
+    int                             p_lastNode = NoNode;
+
+    // Returned by mapNode() and mapLine() when there is no valid counterpart
+    static const int Unmappable = -2;
+
+    struct JournalEntry {
+        int         node;
+        IndexNode   value;  // As it was before the change
+    };
+
+    struct Checkpoint {
+        int             lineNumber = 0;
+        int             nodeCount = 0;
+        int             journalSize = 0;
+        int             lastNode = NoNode;
+        int             nestingLevel = 0;
+        int             maxNesting = -1;
+        QString         line;
+        QSet<QString>   funcAtWork;
+        QList<int>      topLevelNodes;
+        QHash<int, int> rootNodes;
+        QHash<QString, int> scopeRoots;
+        QSet<int>       usefulNodeTypes;
+        ScanState       scanState;      // Of the master class
+    };
+
+    // The result of the previous run, held while we resume and compared against
+    struct PreviousRun {
+        QList<IndexNode>    nodes;
+        QList<JournalEntry> journal;
+        QList<Checkpoint>   checkpoints;
+        int                 documentSize = 0;
+        int                 cleanLine = 0;      // First line behind the edited lines
+    };
+
+    QList<JournalEntry>             p_journal;      // Changes of nodes older than the last checkpoint
+    QList<Checkpoint>               p_checkpoints;  // In order of their line numbers
+    int                             p_journalFloor = 0; // Nodes below are part of the last checkpoint
+    int                             p_nextCheckpoint = 0;
+    int                             p_parsedDocumentSize = 0; // Of the last finished run
+
+    // Edited lines since the last snapshot, the begin is counted from the top,
+    // the end from the bottom of the document so it is not affected by later edits
+    int                             p_editedBegin = -1;
+    int                             p_uneditedTail = 0;
+    bool                            p_fullParseNeeded = true;
+    QString                         p_resultCacheKey;   // Set when the running parse should be cached
+    QString                         p_resultCacheFile;  // Where the result with this key is kept
+    bool                            p_resultCacheEnabled = true;
+    bool                            p_resultFromCache = false; // The worker has loaded it instead of parsing
+
+    // Only valid while we resume
+    PreviousRun                     p_previousRun;
+    bool                            p_resuming = false;
+    int                             p_resumeNodeCount = 0;  // Nodes in front of it are the same in both runs
+    int                             p_lineDelta = 0;        // Lines added by the edit, or removed if negative
+    int                             p_editBegin = 0;        // First edited line
+    int                             p_cleanLine = 0;        // First line behind the edited lines
+    int                             p_matchNodeCount = 0;   // Used by mapNode()...
+    int                             p_matchOldNodeCount = 0;
+    int                             p_matchCheckpoint = 0;
+    QHash<int, int>                 p_mappedNodes;          // ...to remember already compared nodes
+
+    struct ChunkRun {
+        Parser         *parser = nullptr;
+        int             warmUpLine = 0;     // Where the chunk parser start
+        int             beginLine = 0;      // Where we take over
+        QFuture<void>   future;
+    };
+
+    // Only valid while we parse a big document in parallel
+    QList<ChunkRun>                 p_chunkRuns;            // In order of their lines
+    QList<Parser *>                 p_chunkParsers;         // Our children, kept for the next chunk runs
+    int                             p_nextChunkRun = 0;
+    int                             p_chunksTakenOver = 0;
+    bool                            p_chunkRunsEnabled = true;
+    QSet<int>                       p_chunkLines;           // Where a checkpoint is always saved
+    bool                            p_adoptingChunk = false;    // mapNode() use only p_mappedNodes
+
+    // Only valid when we are the chunk parser of some other
+    Parser                         *p_chunkMaster = nullptr;    // Set in the ctor, we don't follow the document
+    int                             p_chunkBegin = -1;
+    int                             p_chunkEnd = -1;
+    bool                            p_foreignLookup = false;    // Something was looked up our master may have more of
+    QSet<QString>                   p_missedScopes;             // Not found by scopeRoot(), our master may have them
 
 };
 
@@ -58,6 +58,8 @@ PhpParser::PhpParser(QObject *view, KTextEditor::Document *doc)
     m_rxVariable = QRegularExpression(QStringLiteral("\\$(\\w+)"), QRegularExpression::CaseInsensitiveOption);
 
     initHereDoc(QStringLiteral("<<<"), QStringLiteral("'"));
+    // Everything outside of <?php ?> is ignored
+    useLexer(DoubleQuotedStrings | SingleQuotedStrings | SlashStarComments | DoubleSlashComments | SharpComments | PhpTags);
 }
 
 
@@ -99,36 +101,11 @@ void PhpParser::parseDocument()
 }
 
 
-void PhpParser::removeStrings()
+void PhpParser::stripLine()
 {
-    removeDoubleQuotedStrings();
-    removeSingleQuotedStrings();
-
-    // Ignore everything until we had read php open tag
-    if (m_line.contains(QStringLiteral("<?php"))) {
-        m_line = m_line.section(QStringLiteral("<?php"), -1, -1);
-        m_line = m_line.trimmed();
-        m_funcAtWork.insert(Me_At_Work);
-    }
-
-    if (m_funcAtWork.contains(Me_At_Work)) {
-        if (m_line.contains(QStringLiteral("?>"))) {
-            m_line = m_line.section(QStringLiteral("?>"), 0, 0);
-            m_funcAtWork.remove(Me_At_Work);
-        }
-    } else {
-        m_line.clear();
-    }
+    ProgramParser::stripLine();
 
     removeHereDoc();
 }
 
-
-void PhpParser::removeComment()
-{
-    removeMultiLineSlashStarComment();
-    removeTrailingDoubleSlashComment();
-    removeTrailingSharpComment();
-}
-
 // kate: space-indent on; indent-width 4; replace-tabs on;
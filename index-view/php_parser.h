@@ -57,8 +57,7 @@ protected:
                                                       "2007 Massimo Callegari"); } ;
 
     void parseDocument() override;
-    void removeStrings() override;
-    void removeComment() override;
+    void stripLine() override;
 
     QRegularExpression m_rxDefine;
     QRegularExpression m_rxConst;
@@ -43,31 +43,41 @@ PlainTextParser::~PlainTextParser()
 }
 
 
-void PlainTextParser::parseDocument()
+void PlainTextParser::prepareForParse()
+{
+    initHistory(3);
+
+    DocumentParser::prepareForParse();
+}
+
+
+int PlainTextParser::classifyLine(QStringView line) const
 {
     static const QRegularExpression rxEqual(QStringLiteral("^[=#*]{3,}$"));
     static const QRegularExpression rxDash(QStringLiteral("^[-~^]{3,}$"));
-    static const QRegularExpression rxIsoDate(QStringLiteral("^\\d{4}-([0]\\d|1[0-2])-([0-2]\\d|3[01])$"));
 
-    QString paraLine;   // First line of a paragraph
+    // Investigate the line as parseDocument() get it as m_line
+    const QString simplified = simplifiedLine(line);
 
-    initHistory(3);
+    if (simplified.contains(rxDash)) {
+        return DashLine;
+    } else if (simplified.contains(rxEqual)) {
+        return EqualLine;
+    }
+
+    return NormalLine;
+}
+
+
+void PlainTextParser::parseDocument()
+{
+    static const QRegularExpression rxIsoDate(QStringLiteral("^\\d{4}-([0]\\d|1[0-2])-([0-2]\\d|3[01])$"));
+
+    classifyLines();
 
     while (nextLine()) {
-        // Let's start the investigation
-        bool currIsEqualLine = m_line.contains(rxEqual);
-        bool currIsDashLine  = m_line.contains(rxDash);
-
-        // Keep a record of the history
-        if (m_line.isEmpty()) {
-            addToHistory(EmptyLine, m_line);
-        } else if (currIsDashLine) {
-            addToHistory(DashLine, m_line);
-        } else if (currIsEqualLine) {
-            addToHistory(EqualLine, m_line);
-        } else {
-            addToHistory(NormalLine, m_line);
-        }
+        // Keep a record of the history, the investigation was done by classifyLine()
+        addToHistory(m_line.isEmpty() ? EmptyLine : lineType(), m_line);
 
         // Waste some memory to increase readability
         const int line0Type = m_lineTypeHistory.at(0); // Oldest line
@@ -77,10 +87,10 @@ void PlainTextParser::parseDocument()
         // Check for Paragraph begin
         if (m_paraLineNumber < 0) {
             if (line1Type == NormalLine) {
-                paraLine = m_lineHistory.at(1);
+                m_paraLine = m_lineHistory.at(1);
                 m_paraLineNumber = lineNumber() - 1;
             } else if (line2Type == NormalLine) {
-                paraLine = m_lineHistory.at(2);
+                m_paraLine = m_lineHistory.at(2);
                 m_paraLineNumber = lineNumber();
             } else {
                 continue;
@@ -93,9 +103,9 @@ void PlainTextParser::parseDocument()
         bool line0IsDate = m_lineHistory.at(0).contains(rxIsoDate);
         bool line1IsDate = m_lineHistory.at(1).contains(rxIsoDate);
 
-        if (line0IsDate && line1Type == EqualLine && line2Type == NormalLine && lastNode()) {
+        if (line0IsDate && line1Type == EqualLine && line2Type == NormalLine && lastNode() != NoNode) {
             QString mask(QStringLiteral("%1 %2"));
-            lastNode()->setText(0, mask.arg(m_lineHistory.at(0)).arg(m_lineHistory.at(2)));
+            setNodeText(lastNode(), mask.arg(m_lineHistory.at(0)).arg(m_lineHistory.at(2)));
             initHistory();
 
         } else if (line0Type != NormalLine && line1IsDate && line2Type == NormalLine) {
@@ -110,11 +120,11 @@ void PlainTextParser::parseDocument()
 
             // Check for Paragraph - Single line
         } else if (line0Type != NormalLine && line1Type == NormalLine  && line2Type == EmptyLine) {
-            addNode(ParaNode, paraLine, m_paraLineNumber);
+            addNode(ParaNode, m_paraLine, m_paraLineNumber);
 
             // Check for Paragraph - Two or more lines
         } else if (line0Type == NormalLine && line1Type == NormalLine  && line2Type != NormalLine) {
-            addNode(ParaNode, paraLine, m_paraLineNumber);
+            addNode(ParaNode, m_paraLine, m_paraLineNumber);
 
             // Check for Header
         } else if (line0Type != NormalLine && line1Type == NormalLine && line2Type == DashLine) {
@@ -148,6 +158,14 @@ IniFileParser::~IniFileParser()
 }
 
 
+void IniFileParser::prepareForParse()
+{
+    initHistory(1);
+
+    DocumentParser::prepareForParse();
+}
+
+
 void IniFileParser::parseDocument()
 {
     static const QRegularExpression rxBrackets(QStringLiteral(R"(^\[(.+)\]$)"));
@@ -172,11 +190,9 @@ void IniFileParser::parseDocument()
     //      [MainWindow0-ViewSpace 0]
     //      [MainWindow0-ViewSpace 0 file:///some/url/foo.bar]   <= Make nice trouble
 
-    initHistory(1);
-
     QRegularExpressionMatch rxMatch;
 
-    QTreeWidgetItem *docRoot = rootNode(RootNode);
+    const int docRoot = rootNode(RootNode);
 
     while (nextLine()) {
         // Let's start the investigation
@@ -201,31 +217,23 @@ void IniFileParser::parseDocument()
 
         // We can't assume that the now collected "path" is already in it's logical position
         // so we must look at our tree if we find some existing top section
-        QTreeWidgetItem *node = docRoot;
+        int node = docRoot;
         int i = 0;
-        bool sectionExist = false;
         while (i < m_sections.size()) {
-            for (int j = 0; j < node->childCount(); ++j) {
-//                 qDebug() << "COMPARE" << i << j << node->child(j)->text(0) << m_sections.at(i);
-                if (node->child(j)->text(0) == m_sections.at(i)) {
-                    node = node->child(j);
-                    sectionExist = true;
-                    break;
-                }
-            }
-            if (!sectionExist) {
-                lastNode()->setData(0, NodeData::EndLine, lineNumber() - 1);
+            const int child = findChild(node, m_sections.at(i));
+            if (child == NoNode) {
+                setNodeEndLine(lastNode(), lineNumber() - 1);
                 addNodesToParent(node, i);
                 break;
             }
-            sectionExist = false;
+            node = child;
             ++i;
         }
     }
 }
 
 
-void IniFileParser::addNodesToParent(QTreeWidgetItem *parentNode, int pos)
+void IniFileParser::addNodesToParent(int parentNode, int pos)
 {
     for (int i = pos; i < m_sections.size(); ++i) {
         parentNode = addNodeToParent(i+1, parentNode, m_sections.at(i));
@@ -257,6 +265,33 @@ DiffFileParser::~DiffFileParser()
 }
 
 
+void DiffFileParser::prepareForParse()
+{
+    m_fileNode = NoNode;
+    m_chunkLineNumber = -1;
+
+    DocumentParser::prepareForParse();
+}
+
+
+void DiffFileParser::saveScanState(ScanState &state) const
+{
+    DocumentParser::saveScanState(state);
+
+    state.addNode(m_fileNode);
+    state.addLine(m_chunkLineNumber);
+}
+
+
+void DiffFileParser::restoreScanState(ScanState &state)
+{
+    DocumentParser::restoreScanState(state);
+
+    m_fileNode = state.takeNode();
+    m_chunkLineNumber = state.takeLine();
+}
+
+
 void DiffFileParser::parseDocument()
 {
     // Match: diff --xyz a/index-view/plaintext_parser.cpp b/index-view/plaintext_parser.cpp
@@ -269,34 +304,38 @@ void DiffFileParser::parseDocument()
 
     QRegularExpressionMatch rxMatch;
     QStringList m_inputPath;
-    QTreeWidgetItem *fileNode = nullptr;
 
     while (nextLine()) {
+        // The line behind a chunk header without text is used instead
+        if (m_chunkLineNumber > -1) {
+            addNodeToParent(ChunkNode, m_fileNode, m_line.simplified());
+            setNodeLine(lastNode(), m_chunkLineNumber);
+            m_chunkLineNumber = -1;
+            continue;
+        }
+
         // Let's start the investigation
         if (m_line.contains(rxUrl1, &rxMatch)) {
             m_inputPath = rxMatch.captured(1).split(QLatin1Char('/'), Qt::SkipEmptyParts);
-            if (!fileNode || fileNode->text(0) != m_inputPath.at(m_inputPath.size()-1)) {
-                fileNode =  addLimbToNode(Section1Node, Section6Node, m_inputPath);
+            if (m_fileNode == NoNode || nodeText(m_fileNode) != m_inputPath.at(m_inputPath.size()-1)) {
+                m_fileNode =  addLimbToNode(Section1Node, Section6Node, m_inputPath);
             }
 
         } else if (m_line.contains(rxUrl2, &rxMatch)) {
             m_inputPath = rxMatch.captured(1).split(QLatin1Char('/'), Qt::SkipEmptyParts);
-            if (!fileNode || fileNode->text(0) != m_inputPath.at(m_inputPath.size()-1)) {
-                fileNode =  addLimbToNode(Section1Node, Section6Node, m_inputPath);
+            if (m_fileNode == NoNode || nodeText(m_fileNode) != m_inputPath.at(m_inputPath.size()-1)) {
+                m_fileNode =  addLimbToNode(Section1Node, Section6Node, m_inputPath);
             }
 
         } else if (m_line.contains(rxChunks, &rxMatch)) {
-            if (m_noNumberAsChunk->isChecked()) {
+            if (optionIsChecked(m_noNumberAsChunk)) {
                 if (rxMatch.captured(2).isEmpty()) {
-                    int lineNo = lineNumber();
-                    nextLine();
-                    addNodeToParent(ChunkNode, fileNode, m_line.simplified());
-                    lastNode()->setData(0, NodeData::Line, lineNo);
+                    m_chunkLineNumber = lineNumber();
                 } else {
-                    addNodeToParent(ChunkNode, fileNode, rxMatch.captured(2).simplified());
+                    addNodeToParent(ChunkNode, m_fileNode, rxMatch.captured(2).simplified());
                 }
             } else {
-                addNodeToParent(ChunkNode, fileNode, rxMatch.captured(1));
+                addNodeToParent(ChunkNode, m_fileNode, rxMatch.captured(1));
             }
         }
     }
@@ -53,6 +53,8 @@ protected:
     QString version() override { return QStringLiteral("0.9.1, Aug 2022"); } ;
     QString author() override { return QStringLiteral("2018, 2022 loh.tar"); } ;
 
+    void prepareForParse() override;
+    int classifyLine(QStringView line) const override;
     void parseDocument() override;
 
 };
@@ -84,9 +86,10 @@ protected:
     QString version() override { return QStringLiteral("0.7, Jul 2022"); } ;
     QString author() override { return QStringLiteral("2022 loh.tar"); } ;
 
+    void prepareForParse() override;
     void parseDocument() override;
 
-    void addNodesToParent(QTreeWidgetItem *parentNode, int pos);
+    void addNodesToParent(int parentNode, int pos);
 
     QStringList m_sections; // Collect all sub sections, like a path
 };
@@ -119,9 +122,15 @@ protected:
     QString version() override { return QStringLiteral("0.5, Jul 2022"); } ;
     QString author() override { return QStringLiteral("2022 loh.tar\n\nATM is only the normal git diff format supported"); } ;
 
+    void prepareForParse() override;
+    void saveScanState(ScanState &state) const override;
+    void restoreScanState(ScanState &state) override;
     void parseDocument() override;
 
     QAction *m_noNumberAsChunk;
+
+    int m_fileNode = NoNode;        // The node of the current file
+    int m_chunkLineNumber = -1;     // Line of a chunk header which need the next line as text
 };
 
 #endif
@@ -35,10 +35,7 @@ ProgramParser::ProgramParser(QObject *view, KTextEditor::Document *doc)
     p_viewTree->setText(i18n("Structure View"));
     p_viewTree->setObjectName(QStringLiteral("StructureView"));
 
-    using namespace IconCollection;
-    registerViewOption(FixmeTodoNode, FixmeTodoIcon, QStringLiteral("FIXME/TODO"), i18n("Show FIXME/TODO"));
-    registerViewOption(BeginNode, BeginIcon, QStringLiteral("BEGIN"), i18n("Show BEGIN"));
-    m_detachedNodeTypes << FixmeTodoNode << BeginNode;
+    useCommentTags(FixmeTodoNode, BeginNode);
 }
 
 
@@ -47,15 +44,89 @@ ProgramParser::~ProgramParser()
 }
 
 
-void ProgramParser::parse()
+void ProgramParser::prepareForParse()
 {
-    p_parentNode = nullptr;
-    p_scopeRoots.clear();
+    p_parentNode = NoNode;
     clearNesting();
 
     p_bracesDelta = 0;
 
-    Parser::parse();
+    Parser::prepareForParse();
+}
+
+
+void ProgramParser::saveScanState(ScanState &state) const
+{
+    Parser::saveScanState(state);
+
+    state.addNode(p_parentNode);
+    state.addValue(p_bracesDelta);
+    state.addValue(p_nestingFoo);
+    state.addValue(p_nestingStack.size());
+    for (const int node : p_nestingStack) {
+        state.addNode(node);
+    }
+}
+
+
+void ProgramParser::restoreScanState(ScanState &state)
+{
+    Parser::restoreScanState(state);
+
+    p_parentNode = state.takeNode();
+    p_bracesDelta = state.takeValue();
+    p_nestingFoo = state.takeValue();
+    p_nestingStack.clear();
+    for (int i = state.takeValue(); i > 0; --i) {
+        p_nestingStack.push(state.takeNode());
+    }
+}
+
+
+QList<int> ProgramParser::chunkBorders() const
+{
+    QList<int> borders;
+    int depth = 0;
+    int border = 0; // Behind the last not empty line, where passCheckpoint() is called
+    bool continued = false; // The line before was a preprocessor line ending with a backslash
+
+    for (int i = 0; i < documentSize(); ++i) {
+        const QStringView line = p_lines.line(i);
+        const QStringView trimmed = line.trimmed();
+        if (continued) {
+            continued = trimmed.endsWith(QLatin1Char('\\'));
+            continue;
+        }
+        if (trimmed.isEmpty()) {
+            continue;
+        }
+
+        // Comments and preprocessor lines are read together with the instruction behind them
+        if (trimmed.startsWith(QLatin1Char('#'))) {
+            continued = trimmed.endsWith(QLatin1Char('\\'));
+            continue;
+        }
+        if (trimmed.startsWith(QLatin1Char('*')) || trimmed.startsWith(u"//") || trimmed.startsWith(u"/*")) {
+            continue;
+        }
+
+        const QChar first = line.at(0);
+        if (depth == 0 && border > 0 && !first.isSpace() && first != QLatin1Char('{') && first != QLatin1Char('}')) {
+            borders.append(border);
+        }
+
+        for (const QChar c : line) {
+            if (c == QLatin1Char('{')) {
+                ++depth;
+            } else if (c == QLatin1Char('}') && depth > 0) {
+                --depth;
+            }
+        }
+
+        border = i + 1;
+    }
+
+    return borders;
 }
 
 
@@ -64,6 +135,12 @@ bool ProgramParser::nextInstruction()
     checkNesting();
 
     m_line.clear();
+    p_lexedSize = 0;
+
+    if (passCheckpoint()) {
+        return false;
+    }
+
     // Set m_lineNumber always to the first non empty line read
     m_lineNumber = Parser::lineNumber() + 1;
 
@@ -127,21 +204,28 @@ void ProgramParser::checkNesting()
 
 void ProgramParser::stripLine()
 {
-    m_line = m_line.simplified();
-    m_niceLine = m_line;// FIXME It's not only nice when m_line will append
-    removeStrings();
+    bool commentFound = false;
+    if (p_lexerFlags) {
+        commentFound = lexLine();
+
+    } else {
+        m_line = m_line.simplified();
+        m_niceLine = m_line;// FIXME It's not only nice when m_line will append
+        removeStrings();
+
+        const int sizeWithComment = m_line.size();
+        removeComment();
+        commentFound = sizeWithComment > m_line.size();
+    }
 
-    const int sizeWithComment = m_line.size();
-    removeComment();
     // Add fixme/todo nodes to the index
-    if (sizeWithComment > m_line.size()) {
-        static const QStringList tags = { QStringLiteral("FIXME|TODO"), QStringLiteral("BEGIN") };
-        static const QList<int> nodes = { FixmeTodoNode, BeginNode };
-        for (int i = 0; i < tags.size(); ++i) {
-            if (addCommentTagNode(tags.at(i), nodes.at(i))) {
-                break;
-            }
-        }
+    if (commentFound) {
+        addCommentTagNode();
+    }
+
+    if (p_lexerFlags) {
+        // Already squashed by the lexer
+        return;
     }
 
     // Squash the line, remove all unneeded space
@@ -150,30 +234,218 @@ void ProgramParser::stripLine()
 }
 
 
-bool ProgramParser::addCommentTagNode(const QString &tag, const int nodeType)
+bool ProgramParser::lexLine()
 {
-    // FIXME ? No static here, but could be done when we again check what kind of tag it is
-    const QRegularExpression regEx = QRegularExpression(QStringLiteral("(.*)\\b(%1)\\b(.*)?").arg(tag));
-    const QRegularExpressionMatch rxMatch = regEx.match(rawLine());
-    if (!rxMatch.hasMatch()) {
+    // Kept in m_funcAtWork, so that a checkpoint knows where we are
+    static const QString inSlashStarComment = QStringLiteral("ProgramParser::lexLine() /*");
+    static const QString inBackQuotedString = QStringLiteral("ProgramParser::lexLine() `");
+    static const QString inPhpCode = QStringLiteral("ProgramParser::lexLine() <?php");
+
+    if (!p_lexedSize || p_lexedSize > m_line.size()) {
+        // A fresh start or someone has changed m_line behind our back
+        p_lexedSize = 0;
+        p_lexedOpenBraces = 0;
+        p_lexedCloseBraces = 0;
+    }
+
+    const QStringView newText = QStringView(m_line).sliced(p_lexedSize);
+
+    // The same as m_line.simplified() with a clean front
+    m_niceLine = m_line.left(p_lexedSize);
+    bool spaceSeen = false;
+    for (const QChar c : newText) {
+        if (c.isSpace()) {
+            spaceSeen = true;
+            continue;
+        }
+        if (spaceSeen && !m_niceLine.isEmpty()) {
+            m_niceLine.append(QLatin1Char(' '));
+        }
+        spaceSeen = false;
+        m_niceLine.append(c);
+    }
+
+    // Space is only kept between two words, what \W in a QRegularExpression means
+    auto isWordChar = [](const QChar c) {
+        const char16_t u = c.unicode();
+        return (u >= u'a' && u <= u'z') || (u >= u'A' && u <= u'Z') || (u >= u'0' && u <= u'9') || u == u'_';
+    };
+
+    // Search the closing quote, a quote escaped by backslash doesn't count
+    auto closingQuote = [](const QStringView text, qsizetype i) -> qsizetype {
+        const QChar quote = text.at(i);
+        for (++i; i < text.size(); ++i) {
+            if (text.at(i) == QLatin1Char('\\')) {
+                ++i;
+            } else if (text.at(i) == quote) {
+                return i;
+            }
+        }
+        return -1;
+    };
+
+    QString line = m_line.left(p_lexedSize);
+    line.reserve(m_line.size());
+    bool inComment = m_funcAtWork.contains(inSlashStarComment);
+    bool inRawString = m_funcAtWork.contains(inBackQuotedString);
+    bool inPhp = !(p_lexerFlags & PhpTags) || m_funcAtWork.contains(inPhpCode);
+    bool commentFound = inComment;
+    spaceSeen = false;
+
+    const qsizetype size = newText.size();
+    qsizetype i = 0;
+    while (i < size) {
+        if (!inPhp) {
+            i = newText.indexOf(u"<?php", i);
+            if (i < 0) {
+                break;
+            }
+            inPhp = true;
+            i += 5;
+            continue;
+        }
+
+        if (inComment) {
+            i = newText.indexOf(u"*/", i);
+            if (i < 0) {
+                break;
+            }
+            inComment = false;
+            i += 2;
+            continue;
+        }
+
+        if (inRawString) {
+            // Back quoted strings know no escapes and may run over many lines
+            i = newText.indexOf(QLatin1Char('`'), i);
+            if (i < 0) {
+                break;
+            }
+            inRawString = false;
+            ++i;
+            continue;
+        }
+
+        const QChar c = newText.at(i);
+        const QChar next = i + 1 < size ? newText.at(i + 1) : QChar();
+
+        if (c.isSpace()) {
+            spaceSeen = true;
+            ++i;
+            continue;
+        }
+
+        if ((p_lexerFlags & SlashStarComments) && c == QLatin1Char('/') && next == QLatin1Char('*')) {
+            inComment = true;
+            commentFound = true;
+            i += 2;
+            continue;
+        }
+
+        if (((p_lexerFlags & DoubleSlashComments) && c == QLatin1Char('/') && next == QLatin1Char('/'))
+            || ((p_lexerFlags & SharpComments) && c == QLatin1Char('#'))) {
+            commentFound = true;
+            // PHP code ends even inside of a trailing comment
+            i = (p_lexerFlags & PhpTags) ? newText.indexOf(u"?>", i) : -1;
+            if (i < 0) {
+                break;
+            }
+            inPhp = false;
+            i += 2;
+            continue;
+        }
+
+        if ((p_lexerFlags & PhpTags) && c == QLatin1Char('?') && next == QLatin1Char('>')) {
+            inPhp = false;
+            i += 2;
+            continue;
+        }
+
+        if ((p_lexerFlags & BackQuotedStrings) && c == QLatin1Char('`')
+            && !(next == QLatin1Char('\'') && i > 0 && newText.at(i - 1) == QLatin1Char('\''))) {
+            // Not the rune '`' but a raw string
+            inRawString = true;
+            ++i;
+            continue;
+        }
+
+        if (((p_lexerFlags & DoubleQuotedStrings) && c == QLatin1Char('"'))
+            || ((p_lexerFlags & SingleQuotedStrings) && c == QLatin1Char('\''))) {
+            const qsizetype end = closingQuote(newText, i);
+            // An unclosed quote is kept as ordinary char
+            if (end > 0) {
+                i = end + 1;
+                continue;
+            }
+        }
+
+        if (spaceSeen && !line.isEmpty() && isWordChar(line.back()) && isWordChar(c)) {
+            line.append(QLatin1Char(' '));
+        }
+        spaceSeen = false;
+
+        if (c == QLatin1Char('{')) {
+            ++p_lexedOpenBraces;
+        } else if (c == QLatin1Char('}')) {
+            ++p_lexedCloseBraces;
+        }
+
+        line.append(c);
+        ++i;
+    }
+
+    if (inComment) {
+        m_funcAtWork.insert(inSlashStarComment);
+    } else {
+        m_funcAtWork.remove(inSlashStarComment);
+    }
+
+    if (inRawString) {
+        m_funcAtWork.insert(inBackQuotedString);
+    } else {
+        m_funcAtWork.remove(inBackQuotedString);
+    }
+
+    if (!(p_lexerFlags & PhpTags)) {
+        // Nothing to do
+    } else if (inPhp) {
+        m_funcAtWork.insert(inPhpCode);
+    } else {
+        m_funcAtWork.remove(inPhpCode);
+    }
+
+    m_line = line;
+    p_lexedSize = m_line.size();
+
+    return commentFound;
+}
+
+
+bool ProgramParser::addCommentTagNode()
+{
+    // All tags are searched at once, FIXME/TODO win over BEGIN, these over the user ones
+    const QStringView line = rawLine();
+    const CommentTagMatcher::Match match = m_commentTags.match(line);
+    if (match.nodeType < 0) {
         return false;
     }
 
-    if (!nodeTypeIsWanted(nodeType)) {
+    if (!nodeTypeIsWanted(match.nodeType)) {
         return true;
     }
 
     // Support also notes where the token is at the end
     // FIXME This solutuon is not best. Better is the trick done in XmlTypeParser but that can we not do
     // here because we have (yet) no "clean" comment string. But we could collect one in our removeComment functions
-    QString txt = rxMatch.captured(3).isEmpty() ? rxMatch.captured(1) : rxMatch.captured(3);
+    const QStringView behind = line.sliced(match.start + match.length);
+    QString txt = (behind.isEmpty() ? line.first(match.start) : behind).toString();
     // Remove possible comment char from both ends in a lazy way. So,
     // something too much could be gone but guess it's OK
     static const QRegularExpression rx1(QStringLiteral("^\\W*"));
     txt.remove(rx1);
     static const QRegularExpression rx2(QStringLiteral("\\W*$"));
     txt.remove(rx2);
-    addNode(nodeType, rxMatch.captured(2).at(0) + QStringLiteral(": ") + txt, m_lineNumber);
+    addNode(match.nodeType, line.at(match.start) + QStringLiteral(": ") + txt, m_lineNumber);
 
     return true;
 }
@@ -303,6 +575,7 @@ void ProgramParser::removeHereDoc()
                 m_line.clear();
             }
             m_line.clear();
+            p_lexedSize = 0;
             m_lineNumber = Parser::lineNumber() + 1;
         }
     }
@@ -311,8 +584,16 @@ void ProgramParser::removeHereDoc()
 
 int ProgramParser::checkForBlocks()
 {
-    int openBraces   = m_line.count(QLatin1Char('{'));
-    int closeBraces  = m_line.count(QLatin1Char('}'));
+    int openBraces;
+    int closeBraces;
+    if (p_lexerFlags && p_lexedSize == m_line.size()) {
+        // Already counted by the lexer
+        openBraces  = p_lexedOpenBraces;
+        closeBraces = p_lexedCloseBraces;
+    } else {
+        openBraces  = m_line.count(QLatin1Char('{'));
+        closeBraces = m_line.count(QLatin1Char('}'));
+    }
 
     p_bracesDelta = openBraces - closeBraces;
 
@@ -332,7 +613,7 @@ int ProgramParser::checkForBlocks()
 
 void ProgramParser::beginOfBlock()
 {
-    QTreeWidgetItem *node = lastNode();
+    const int node = lastNode();
 
     if (!p_nestingStack.isEmpty()) {
         if (p_nestingStack.top() == node) {
@@ -343,7 +624,7 @@ void ProgramParser::beginOfBlock()
         }
     }
 
-    if (node && node->data(0, NodeData::EndLine).toInt() != -1) {
+    if (node != NoNode && nodeEndLine(node) != -1) {
         // Ignore this block
         if (p_nestingFoo < 0) {
             p_nestingFoo = p_nestingStack.size() + 1;
@@ -362,22 +643,22 @@ void ProgramParser::endOfBlock()
     }
 
     if (p_nestingStack.isEmpty()) {
-        p_parentNode = nullptr;
+        p_parentNode = NoNode;
         return;
     }
 
     p_parentNode = p_nestingStack.pop();
-    if (!p_parentNode) {
+    if (p_parentNode == NoNode) {
         return;
     }
 
     if (!p_nestingStack.isEmpty() && p_nestingStack.top() == p_parentNode) {
         return;
     } else {
-        p_parentNode->setData(0, NodeData::EndLine, lineNumber());
+        setNodeEndLine(p_parentNode, lineNumber());
     }
 
-    p_parentNode = p_parentNode->parent();
+    p_parentNode = nodeParent(p_parentNode);
 }
 
 
@@ -390,10 +671,10 @@ void ProgramParser::clearNesting()
 
 void ProgramParser::addNode(const int nodeType, const QString &text, const int lineNumber, const int columnNumber/* = 0*/)
 {
-    QTreeWidgetItem *node = nullptr;
+    int node = NoNode;
 
     if (m_detachedNodeTypes.contains(nodeType)) {
-        node = new QTreeWidgetItem(rootNode(nodeType), nodeType);
+        node = newNode(rootNode(nodeType), nodeType);
         setNodeProperties(node, nodeType, text, lineNumber, columnNumber);
         return;
     }
@@ -405,18 +686,18 @@ void ProgramParser::addNode(const int nodeType, const QString &text, const int l
         return;
     }
 
-    if (!p_parentNode || p_nestingStack.isEmpty()) {
+    if (p_parentNode == NoNode || p_nestingStack.isEmpty()) {
         p_parentNode = rootNode(nodeType);
     }
-    if (m_nonBlockElements.contains(p_parentNode->type()) && p_parentNode->type() != nodeType) {
-        p_parentNode = p_rootNodes.value(nodeType);
+    if (m_nonBlockElements.contains(nodeTypeOf(p_parentNode)) && nodeTypeOf(p_parentNode) != nodeType) {
+        p_parentNode = existingRootNode(nodeType);
     }
-    node = new QTreeWidgetItem(p_parentNode, nodeType);
+    node = newNode(p_parentNode, nodeType);
 
     setNodeProperties(node, nodeType, text, lineNumber, columnNumber);
 
     if (m_nonBlockElements.contains(nodeType)) {
-        node->setData(0, NodeData::EndLine, lineNumber);
+        setNodeEndLine(node, lineNumber);
     }
 }
 
@@ -432,15 +713,15 @@ void ProgramParser::addNodeToScope(const QString &scope, const int scopeType, co
         return;
     }
 
-    QTreeWidgetItem *scopeRoot = p_scopeRoots.value(scope, nullptr);
+    int root = scopeRoot(scope);
 
-    if (!scopeRoot) {
-        scopeRoot = new QTreeWidgetItem(p_indexTree, nodeType);
-        setNodeProperties(scopeRoot, scopeType, scope, -1);
-        p_scopeRoots.insert(scope, scopeRoot);
+    if (root == NoNode) {
+        root = newNode(NoNode, nodeType);
+        setNodeProperties(root, scopeType, scope, -1);
+        setScopeRoot(scope, root);
     }
 
-    QTreeWidgetItem *node = new QTreeWidgetItem(scopeRoot, nodeType);
+    const int node = newNode(root, nodeType);
     setNodeProperties(node, nodeType, text, lineNumber, columnNumber);
 }
 
@@ -453,44 +734,43 @@ void ProgramParser::addScopeNode(const int nodeType, const QString &text, const
     //     return;
     // }
 
-    QTreeWidgetItem *node = nullptr;
+    int node = NoNode;
 
-    if (!p_parentNode || p_nestingStack.isEmpty()) {
-        node = p_scopeRoots.value(text, nullptr);
+    if (p_parentNode == NoNode || p_nestingStack.isEmpty()) {
+        node = scopeRoot(text);
 
-        if (node) {
+        if (node != NoNode) {
             // Hm, really nothing else todo?
             return;
         }
 
-        node = new QTreeWidgetItem(p_indexTree, nodeType);
-        p_scopeRoots.insert(text, node);
+        node = newNode(NoNode, nodeType);
+        setScopeRoot(text, node);
         p_parentNode = node; // That's OK?
 
     } else {
-        node = new QTreeWidgetItem(p_parentNode, nodeType);
+        node = newNode(p_parentNode, nodeType);
     }
 
     setNodeProperties(node, nodeType, text, lineNumber, columnNumber);
 }
 
 
-void ProgramParser::addScopeNode(QTreeWidgetItem *parentNode, const int nodeType, const QString &text)
+void ProgramParser::addScopeNode(const int parentNode, const int nodeType, const QString &text)
 {
-    if (!parentNode) {
+    if (parentNode == NoNode) {
         return;
     }
 
-    for (int j = 0; j < parentNode->childCount(); ++j) {
-        if (parentNode->child(j)->text(0) == text) {
-            // Already there
-            p_parentNode = parentNode->child(j);
-            p_lastNode = parentNode->child(j);
-            return;
-        }
+    const int child = findChild(parentNode, text);
+    if (child != NoNode) {
+        // Already there
+        p_parentNode = child;
+        p_lastNode = child;
+        return;
     }
 
-    auto node = new QTreeWidgetItem(parentNode, nodeType);
+    const int node = newNode(parentNode, nodeType);
     setNodeProperties(node, nodeType, text, -1, -1);
     p_parentNode = node;
 }
@@ -47,9 +47,23 @@ public:
     ProgramParser(QObject *view, KTextEditor::Document *doc);
    ~ProgramParser();
 
-    virtual void parse() override;
-
 protected:
+    virtual void prepareForParse() override;
+
+    /**
+    * The nesting and the scope roots are added to the @p state.
+    * @see Parser::saveScanState()
+    */
+    virtual void saveScanState(ScanState &state) const override;
+    virtual void restoreScanState(ScanState &state) override;
+
+    /**
+    * Each not indented line outside of braces is taken as border, no matter if it
+    * is part of a comment or a string.
+    * @see Parser::chunkBorders()
+    */
+    virtual QList<int> chunkBorders() const override;
+
     /**
     * Overwrite these enum with an enhanced version in a sub class and ensure
     * to start with "FooNode = FirstNodeType,".
@@ -65,6 +79,7 @@ protected:
     * This function iterate with each call over the document until no more data is left.
     * As long as lineIsGood() not returns "true" will lines to @c m_line appended
     * and @c m_lineNumber set. To do so is Parser::appendNextLine() called.
+    * Before a new instruction is read is Parser::passCheckpoint() called.
     * @warning This function clears @c m_line before doing its job
     * @returns true when successfull read, and false when no more data found
     */
@@ -87,17 +102,43 @@ protected:
 
     /**
      * This function will called in nextInstruction() to set @c m_line and @c m_niceLine.
-     * To achive this will first removeStrings() and then removeComment() called.
+     * To achive this will first removeStrings() and then removeComment() called, or
+     * when useLexer() was called the lexer do all of it in one go.
      * Furthermore will be here the BEGIN/FIXME/TODO tags recognised and add to our tree.
      */
     virtual void stripLine();
 
+    /**
+     * The features of a language the lexer has to know, see useLexer()
+     */
+    enum LexerFlag {
+        DoubleQuotedStrings = 0x01,
+        SingleQuotedStrings = 0x02,
+        BackQuotedStrings   = 0x04,
+        SlashStarComments   = 0x08,
+        DoubleSlashComments = 0x10,
+        SharpComments       = 0x20,
+        PhpTags             = 0x40  // Ignore all outside of <?php ?>
+    };
+
+    /**
+     * Call this function in the parser constructor of a C like language to let
+     * stripLine() run a hand written lexer instead of removeStrings(), removeComment()
+     * and a couple of regular expressions. The lexer walks once over each newly read
+     * line, remove strings and comments and squash the line at the same time.
+     * Strings are only removed when they are closed on the same line, except back
+     * quoted strings which are taken as raw strings which may run over many lines.
+     * @note removeStrings() and removeComment() are then no longer called
+     * @param flags are the ORed LexerFlag values which fit the language
+     */
+    void useLexer(const int flags) { p_lexerFlags = flags; };
+
     /**
      * Helper function only used by stripLine() to add FIXME/TODO/BEGIN tags and
-     * maybe some more.
+     * these the user has configured, see Parser::useCommentTags()
      * @returns true when some tag was found
      */
-    bool addCommentTagNode(const QString &tag, const int nodeType);
+    bool addCommentTagNode();
 
     /**
      * This function will called in stripLine() and remove by default all double
@@ -208,7 +249,7 @@ protected:
     /**
      * This function add a new root node with the caption of @p text to  the tree when
      * there is no current nesting situation. With nesting the node is add below the parent.
-     * Without a nesting situation the new node is added to @c p_scopeRoots. Should such
+     * Without a nesting situation the new node is kept as scope root. Should such
      * scope already exist, nothing is done.
      * @param nodeType the type of the new node, like struct
      * @param text the caption of the new node, visible in the view
@@ -224,9 +265,9 @@ protected:
      * to the new added node. Should such node already exist is only @c p_parentNode set to the existing node.
      */
     // Introduced for C++ Access Specifiers
-    void addScopeNode(QTreeWidgetItem *parentNode, const int nodeType, const QString &text);
+    void addScopeNode(const int parentNode, const int nodeType, const QString &text);
 
-    int parentNodeType() { return p_parentNode ? p_parentNode->type() : -1; }; // Introduced for C++ function declarations
+    int parentNodeType() { return p_parentNode != NoNode ? nodeTypeOf(p_parentNode) : -1; }; // Introduced for C++ function declarations
     int nestingLevel() { return p_nestingStack.size(); }; // Introduced for Tcl
 
     QSet<QString>   m_blockElements;
@@ -243,13 +284,24 @@ protected:
     int             m_lineNumber;
 
 private:
-    QTreeWidgetItem*                  p_parentNode;
-    QStack<QTreeWidgetItem*>          p_nestingStack;
+    /**
+     * The lexer used by stripLine() when useLexer() was called. Only the part of
+     * @c m_line behind @c p_lexedSize is processed, the front is already clean.
+     * @returns true when some comment was found
+     */
+    bool lexLine();
+
+    int                               p_parentNode;
+    QStack<int>                       p_nestingStack;
     int                               p_bracesDelta;
     int                               p_nestingFoo; // FIXME Need better name. It's used to ignore nested content when parent is not wanted
     QRegularExpression                p_rxHereDocOperator;
     QList<QRegularExpression>         p_hereDocRxList;
-    QHash<QString, QTreeWidgetItem*>  p_scopeRoots; // Introduced for C++ function definitions
+
+    int                               p_lexerFlags = 0;
+    int                               p_lexedSize = 0;      // Size of the clean front of m_line
+    int                               p_lexedOpenBraces = 0;
+    int                               p_lexedCloseBraces = 0;
 };
 
 #endif
@@ -46,23 +46,48 @@ PythonParser::~PythonParser()
 }
 
 
+void PythonParser::prepareForParse()
+{
+    m_lastIndent = 0;
+
+    ProgramParser::prepareForParse();
+}
+
+
+void PythonParser::saveScanState(ScanState &state) const
+{
+    ProgramParser::saveScanState(state);
+
+    state.addValue(m_lastIndent);
+    state.addText(m_quoteToken);
+}
+
+
+void PythonParser::restoreScanState(ScanState &state)
+{
+    ProgramParser::restoreScanState(state);
+
+    m_lastIndent = state.takeValue();
+    m_quoteToken = state.takeText();
+}
+
+
 void PythonParser::parseDocument()
 {
     static const QRegularExpression rxNonSpace(QStringLiteral("\\S"));
 
-    int lastIndent = 0;
     int currIndent = 0;
 
     while (nextInstruction()) {
         currIndent = rawLine().indexOf(rxNonSpace);
         if (currIndent < 1) {
             clearNesting();
-        } else if (lastIndent < currIndent) {
+        } else if (m_lastIndent < currIndent) {
             beginOfBlock();
-        } else if (lastIndent > currIndent) {
+        } else if (m_lastIndent > currIndent) {
             endOfBlock();
         }
-        lastIndent = currIndent;
+        m_lastIndent = currIndent;
 
         // TODO Use regex/match too
         if (m_line.startsWith(QStringLiteral("class "))) {
@@ -101,12 +126,10 @@ void PythonParser::removeStrings()
 void PythonParser::removeComment()
 {
     // FIXME Is it possible to split this and use a part in/as lineIsGood()?
-    static QString quoteToken;
-
     if (m_funcAtWork.contains(Me_At_Work)) {
         // Remove block with triple quotes,
         // doing it dumb and eager because of to much unknown special cases
-        if (m_line.contains(quoteToken)) {
+        if (m_line.contains(m_quoteToken)) {
             m_funcAtWork.remove(Me_At_Work);
         }
         m_line.clear();
@@ -136,9 +159,9 @@ void PythonParser::removeComment()
     }
 
     if (!posDoubleQuotes) {
-        quoteToken = QStringLiteral("!KPIVTSQ!");
+        m_quoteToken = QStringLiteral("!KPIVTSQ!");
     } else {
-        quoteToken = QStringLiteral("!KPIVTDQ!");
+        m_quoteToken = QStringLiteral("!KPIVTDQ!");
     }
 
     m_funcAtWork.insert(Me_At_Work);
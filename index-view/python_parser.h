@@ -50,11 +50,16 @@ protected:
     QString version() override { return QStringLiteral("0.7, Okt 2018"); } ;
     QString author() override { return QStringLiteral("2018 loh.tar \n\nInspired by \n2003 Massimo Callegari"); } ;
 
+    void prepareForParse() override;
+    void saveScanState(ScanState &state) const override;
+    void restoreScanState(ScanState &state) override;
     void parseDocument() override;
     bool lineIsGood() override { return true; };
     void removeStrings() override;
     void removeComment() override;
 
+    QString             m_quoteToken; // No static inside removeComment(), we run in a worker thread
+    int                 m_lastIndent = 0;
 };
 
 #endif
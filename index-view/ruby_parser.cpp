@@ -67,7 +67,7 @@ void RubyParser::parseDocument()
 
         } else if (m_line.startsWith(QStringLiteral("def "))) {
             m_line = m_line.mid(4);
-            if (!m_showParameters->isChecked()) {
+            if (!optionIsChecked(m_showParameters)) {
                 m_line = m_line.section(QLatin1Char('('), 0, 0);
             }
             addNode(MethodNode, m_line, m_lineNumber);
@@ -51,6 +51,22 @@ TclParser::~TclParser()
 }
 
 
+void TclParser::saveScanState(ScanState &state) const
+{
+    ProgramParser::saveScanState(state);
+
+    state.addValue(m_if0NestingLevel);
+}
+
+
+void TclParser::restoreScanState(ScanState &state)
+{
+    ProgramParser::restoreScanState(state);
+
+    m_if0NestingLevel = state.takeValue();
+}
+
+
 void TclParser::parseDocument()
 {
     QRegularExpressionMatch rxMatch;
@@ -59,7 +75,7 @@ void TclParser::parseDocument()
         // Let's start the investigation
         if (m_line.contains(m_rxVariable, &rxMatch)) {
             m_line = rxMatch.captured(1);
-            if (m_showAssignments->isChecked()) {
+            if (optionIsChecked(m_showAssignments)) {
                 // Assignment could be improved, e.g. catch strings from m_niceLine
                 // but I'm not sure if variables are so important. I have kept
                 // them only for "historic reasons"
@@ -69,7 +85,7 @@ void TclParser::parseDocument()
 
         } else if (m_line.contains(m_rxFunction, &rxMatch)) {
             m_line = rxMatch.captured(1);
-            if (m_showParameters->isChecked()) {
+            if (optionIsChecked(m_showParameters)) {
                 m_line.append(QLatin1Char(' ') + rxMatch.captured(2));
             }
             addNode(FunctionNode, m_line, m_lineNumber);
@@ -143,12 +159,10 @@ void TclParser::removeComment()
 
 void TclParser::removeTclIf0Comment()
 {
-    static int myNestingLevel;
-
     if (m_funcAtWork.contains(Me_At_Work)) {
         checkForBlocks();
         checkNesting();
-        if (nestingLevel() == myNestingLevel) {
+        if (nestingLevel() == m_if0NestingLevel) {
             m_funcAtWork.remove(Me_At_Work);
         }
         m_line.clear();
@@ -156,7 +170,7 @@ void TclParser::removeTclIf0Comment()
 
     static const QRegularExpression rx(QStringLiteral("^if\\s+0\\s*\\{"));
     if (m_line.contains(rx)) {
-        myNestingLevel = nestingLevel();
+        m_if0NestingLevel = nestingLevel();
         checkForBlocks();
         checkNesting();
         m_funcAtWork.insert(Me_At_Work);
@@ -49,6 +49,8 @@ protected:
     QString version() override { return QStringLiteral("0.6.1, Jul 2022"); } ;
     QString author() override { return QStringLiteral("2018 loh.tar \n\nInspired by \n2003 Massimo Callegari"); } ;
 
+    void saveScanState(ScanState &state) const override;
+    void restoreScanState(ScanState &state) override;
     void parseDocument() override;
     bool lineIsGood() override;
     void removeStrings() override;
@@ -60,6 +62,8 @@ protected:
 
     QRegularExpression  m_rxVariable;
     QRegularExpression  m_rxFunction;
+
+    int                 m_if0NestingLevel = 0;
 };
 
 #endif
@@ -35,14 +35,15 @@ XmlTypeParser::XmlTypeParser(QObject *view, KTextEditor::Document *doc)
 {
     useNestingOptions();
 
+    useCommentTags(FixmeTodoNode, BeginNode);
+
     using namespace IconCollection;
-    registerViewOption(FixmeTodoNode, FixmeTodoIcon, QStringLiteral("FIXME/TODO"), i18n("Show FIXME/TODO"));
-    registerViewOption(BeginNode, BeginIcon, QStringLiteral("BEGIN"), i18n("Show BEGIN"));
     registerViewOption(CommentNode, CommentIcon, QStringLiteral("Comments"), i18n("Show Comments"));
 
     p_detachComments = registerViewOptionModifier(CommentNode, QStringLiteral("DetachComments"), i18n("Detach Comments"));
 
-    m_detachedNodeTypes << FixmeTodoNode << BeginNode;
+    // Our node types are registered while parsing, a cached result would refer to unknown ones
+    m_useResultCache = false;
 
     setNodeTypeIcon(RootNode, DocumentRootIcon);
 }
@@ -62,11 +63,16 @@ void XmlTypeParser::prepareForParse()
     m_line.clear();
     p_currCharIndex = 0;
 
-    p_parentNode = nullptr;
+    p_parentNode = NoNode;
     clearNesting();
     resetNesting();
 
-    p_indexTree->setRootIsDecorated(1);
+    p_contentCollector.clear();
+    p_lastNodeNeedContent = false;
+    p_newContentIsAvailable = false;
+    p_betterConvertTagContent = false;
+
+    setRootIsDecorated(true);
 
     if (p_detachComments->isChecked()) {
         m_detachedNodeTypes << CommentNode;
@@ -77,55 +83,130 @@ void XmlTypeParser::prepareForParse()
     // Add the root node here keeps addNode() less complex
     // Using line number 0 will cause a jump to the top of the document when
     // clicked which make absolutely sense.
-    QTreeWidgetItem *node = rootNode(RootNode);
+    const int node = rootNode(RootNode);
     setNodeProperties(node, RootNode, i18n("Document"), 0);
     beginOfBlock();
 }
 
 
+void XmlTypeParser::finishParse()
+{
+    if (!p_tagIcons.isEmpty()) {
+        // Reset intern auto color counter so the colors are always the same between doc type changes
+        IconCollection::getIcon(-1);
+        for (const auto &tagIcon : std::as_const(p_tagIcons)) {
+            p_nodeTypes.insert(tagIcon.first, NodeTypeStruct(nodeTypeName(tagIcon.first), QIcon()));
+            setNodeTypeIcon(tagIcon.first, tagIcon.second);
+        }
+        p_tagIcons.clear();
+    }
+
+    Parser::finishParse();
+}
+
+
+QString XmlTypeParser::nodeTypeName(int nodeType) const
+{
+    // Our tags are only added to the node types by finishParse()
+    for (auto it = p_tagTypes.constBegin(); it != p_tagTypes.constEnd(); ++it) {
+        if (it.value().nodeType == nodeType) {
+            return it.key();
+        }
+    }
+
+    return Parser::nodeTypeName(nodeType);
+}
+
+
+void XmlTypeParser::saveScanState(ScanState &state) const
+{
+    Parser::saveScanState(state);
+
+    state.addValue(p_currCharIndex);
+    state.addNode(p_parentNode);
+    state.addValue(p_nestingFoo);
+    state.addValue(p_nestingStack.size());
+    for (const int node : p_nestingStack) {
+        state.addNode(node);
+    }
+
+    state.addText(p_contentCollector);
+    state.addValue(p_lastNodeNeedContent);
+    state.addValue(p_newContentIsAvailable);
+    state.addValue(p_betterConvertTagContent);
+
+    state.addValue(p_docTypeHint.size());
+    for (const QString &hint : p_docTypeHint) {
+        state.addText(hint);
+    }
+}
+
+
+void XmlTypeParser::restoreScanState(ScanState &state)
+{
+    Parser::restoreScanState(state);
+
+    p_currCharIndex = state.takeValue();
+    p_parentNode = state.takeNode();
+    p_nestingFoo = state.takeValue();
+    p_nestingStack.clear();
+    for (int i = state.takeValue(); i > 0; --i) {
+        p_nestingStack.push(state.takeNode());
+    }
+
+    p_contentCollector = state.takeText();
+    p_lastNodeNeedContent = state.takeValue();
+    p_newContentIsAvailable = state.takeValue();
+    p_betterConvertTagContent = state.takeValue();
+
+    QStringList docTypeHint;
+    for (int i = state.takeValue(); i > 0; --i) {
+        docTypeHint.append(state.takeText());
+    }
+    // A doc type tag behind the checkpoint may have changed the loaded setup
+    if (docTypeHint != p_docTypeHint) {
+        detectDocType(docTypeHint);
+    }
+}
+
+
 void XmlTypeParser::parseDocument()
 {
 //     qDebug() << "XmlTypeParser::parseDocument";
-    // Tag content of our interest is often spiked with inline tags which we not even know
-    // and ignore. But we need to collect there content and use it for our known tags
-    QString contentCollector;
-    bool lastNodeNeedContent = false;
-    bool newContentIsAvailable = false;
-
-    auto collectUnusedContent = [this, &contentCollector, &lastNodeNeedContent, &newContentIsAvailable]() {
-        if (!lastNodeNeedContent || p_nonWhiteSpaceRead < 1) {
+    auto collectUnusedContent = [this]() {
+        if (!p_lastNodeNeedContent || p_nonWhiteSpaceRead < 1) {
             return;
         }
-        contentCollector.append(QLatin1Char(' '));
-        contentCollector.append(m_tagContent);
-        newContentIsAvailable = true;
+        p_contentCollector.append(QLatin1Char(' '));
+        p_contentCollector.append(m_tagContent);
+        p_newContentIsAvailable = true;
     };
 
-    auto updateTextOnLastNode = [this, &contentCollector, &lastNodeNeedContent, &newContentIsAvailable]() {
-        if (!lastNodeNeedContent) {
+    auto updateTextOnLastNode = [this]() {
+        if (!p_lastNodeNeedContent) {
             return;
         }
         // Reset this hint early, ensure we don't miss this...
-        lastNodeNeedContent = false;
+        p_lastNodeNeedContent = false;
 
-        if (contentCollector.isEmpty()) {
+        if (p_contentCollector.isEmpty()) {
              return;
-        } else if (!newContentIsAvailable) {
+        } else if (!p_newContentIsAvailable) {
             p_betterConvertTagContent = false;
-            contentCollector.clear();
+            p_contentCollector.clear();
             return;
         }
 
         // Only update when the node was not already closed => content not related to this node
-        if (lastNode()->data(0, EndLine).toInt() < 0) {
-//             qDebug() << "UPDATE TEXT <" << lastNode()->text(0) << lastNode()->data(0, EndLine).toInt() << p_betterConvertTagContent;
-            lastNode()->setText(0, convertTagContent(contentCollector));
-//             qDebug() << "UPDATE TEXT >" << lastNode()->text(0);
+        if (nodeEndLine(lastNode()) < 0) {
+//             qDebug() << "UPDATE TEXT <" << nodeText(lastNode()) << nodeEndLine(lastNode()) << p_betterConvertTagContent;
+            setNodeText(lastNode(), convertTagContent(p_contentCollector));
+//             qDebug() << "UPDATE TEXT >" << nodeText(lastNode());
         }
         // ...and that. Now all important stuff is reset, ready for next customer
-        newContentIsAvailable = false;
+        p_newContentIsAvailable = false;
         p_betterConvertTagContent = false;
-        contentCollector.clear();
+        p_contentCollector.clear();
     };
 
     while (nextTag()) {
@@ -149,14 +230,12 @@ void XmlTypeParser::parseDocument()
             m_tagContent.remove(rx2);
             // I have also seen empty comments, these are pointless, skip them!
             if (!m_tagContent.isEmpty()) {
-                if (!addSpecialCommentNode(QStringLiteral("FIXME|TODO"), FixmeTodoNode)) {
-                    if (!addSpecialCommentNode(QStringLiteral("BEGIN"), BeginNode)) {
-                        addNode(CommentNode);
-                    }
+                if (!addSpecialCommentNode()) {
+                    addNode(CommentNode);
                 }
 
-                if (!p_detachComments->isChecked()) {
-                    lastNode()->setData(0, EndLine, lineNumber());
+                if (!optionIsChecked(p_detachComments)) {
+                    setNodeEndLine(lastNode(), lineNumber());
                 }
             }
 
@@ -174,20 +253,20 @@ void XmlTypeParser::parseDocument()
                 if (p_nonWhiteSpaceRead < 1) {
                     m_tagContent = m_tagName;
                 } else {
-                    contentCollector = m_tagContent;
+                    p_contentCollector = m_tagContent;
                 }
 
-                if (addNode(tagNodeType()) && lastNode()->text(0).size() < Max_View_Lenght) {
-                    lastNodeNeedContent = true;
+                if (addNode(tagNodeType()) && nodeText(lastNode()).size() < Max_View_Lenght) {
+                    p_lastNodeNeedContent = true;
                 } else {
-                    contentCollector.clear();
+                    p_contentCollector.clear();
                 }
             }
 
             beginOfBlock();
 
         } else if (tagIsKnownEndTag()) {
-            if (lastNode() && tagNodeTypeEndTag() == lastNode()->type()) {
+            if (lastNode() != NoNode && tagNodeTypeEndTag() == nodeTypeOf(lastNode())) {
                 updateTextOnLastNode();
             }
             endOfBlock(); // Important to call after updateTextOnLastNode() !
@@ -197,8 +276,6 @@ void XmlTypeParser::parseDocument()
         }
     }
 
-    if (p_gitConflict) return;
-
     // It could be that now is some text pending, use it
     updateTextOnLastNode();
     // Ensure our root node got EndLine set
@@ -206,27 +283,25 @@ void XmlTypeParser::parseDocument()
 
     // When we have only found comments looks the empty added root node odd,
     // even more because they is not on top but below the comment root node
-    QTreeWidgetItem *rootNode = p_rootNodes.value(RootNode);
-    if (rootNode->childCount() < 1) {
-        rootNode->setHidden(true);
+    const int rootNode = p_rootNodes.value(RootNode);
+    if (childCount(rootNode) < 1) {
+        setNodeHidden(rootNode, true);
     }
 }
 
 
-bool XmlTypeParser::addSpecialCommentNode(const QString &rxType, const int nodeType)
+bool XmlTypeParser::addSpecialCommentNode()
 {
-    // FIXME ? No static here, but could be done when we again check what kind of special it is
-    const QRegularExpression regEx = QRegularExpression(QStringLiteral("(.*)\\b(%1)\\b(.*)?").arg(rxType));
-    const QRegularExpressionMatch rxMatch = regEx.match(m_tagContent);
+    const CommentTagMatcher::Match match = m_commentTags.match(m_tagContent);
 
-    if (!rxMatch.hasMatch()) {
+    if (match.nodeType < 0) {
         return false;
     }
 
     // Support also notes where the token is at the end or in the middle of nowhere
-    m_tagContent = rxMatch.captured(1) + rxMatch.captured(3);
+    m_tagContent = m_tagContent.left(match.start) + m_tagContent.mid(match.start + match.length);
     m_tagContent = m_tagContent.simplified(); // Now we are extra pedantic
-    addNode(nodeType);
+    addNode(match.nodeType);
 
     return true;
 }
@@ -313,6 +388,10 @@ QString XmlTypeParser::getStuffBetweenAngleBrackets(int fromAngle, int toAngle)
 
 bool XmlTypeParser::nextTag()
 {
+    if (passCheckpoint()) {
+        return false;
+    }
+
     // Ensure we report no nonsense
     p_currentTagIsComment = false;
     p_currentTagIsEndTagOfType = -1;
@@ -425,7 +504,7 @@ void XmlTypeParser::beginOfBlock()
 {
     ++p_nestingLevel;
 
-    QTreeWidgetItem *node = lastNode();
+    const int node = lastNode();
 
     if (!p_nestingStack.isEmpty()) {
         if (p_nestingStack.top() == node) {
@@ -436,7 +515,7 @@ void XmlTypeParser::beginOfBlock()
         }
     }
 
-    if (node && node->data(0, EndLine).toInt() != -1) {
+    if (node != NoNode && nodeEndLine(node) != -1) {
         // Ignore this block
         if (p_nestingFoo < 0) {
             p_nestingFoo = p_nestingStack.size() + 1;
@@ -457,22 +536,22 @@ void XmlTypeParser::endOfBlock()
     }
 
     if (p_nestingStack.isEmpty()) {
-        p_parentNode = nullptr;
+        p_parentNode = NoNode;
         return;
     }
 
     p_parentNode = p_nestingStack.pop();
-    if (!p_parentNode) {
+    if (p_parentNode == NoNode) {
         return;
     }
 
     if (!p_nestingStack.isEmpty() && p_nestingStack.top() == p_parentNode) {
         return;
     } else {
-        p_parentNode->setData(0, EndLine, lineNumber());
+        setNodeEndLine(p_parentNode, lineNumber());
     }
 
-    p_parentNode = p_parentNode->parent();
+    p_parentNode = nodeParent(p_parentNode);
 }
 
 
@@ -507,11 +586,11 @@ bool XmlTypeParser::addNodeWithTextFromAttribute(const int nodeType)
 
 bool XmlTypeParser::addNode(const int nodeType, const QString &text, const int lineNumber, const int columnNumber)
 {
-    QTreeWidgetItem *node = nullptr;
+    int node = NoNode;
 //     qDebug() << "nesting" << p_nestingFoo << p_nestingStack.size();
 
     if (m_detachedNodeTypes.contains(nodeType)) {
-        node = new QTreeWidgetItem(rootNode(nodeType), nodeType);
+        node = newNode(rootNode(nodeType), nodeType);
         setNodeProperties(node, nodeType, convertTagContent(text), lineNumber, columnNumber);
         return true;
     }
@@ -530,18 +609,18 @@ bool XmlTypeParser::addNode(const int nodeType, const QString &text, const int l
         return false;
     }
 
-    if (!p_parentNode || p_nestingStack.isEmpty()) {
+    if (p_parentNode == NoNode || p_nestingStack.isEmpty()) {
         p_parentNode = rootNode(nodeType);
     }
-    if (m_nonBlockElements.contains(p_parentNode->type()) && p_parentNode->type() != nodeType) {
-        p_parentNode = p_rootNodes.value(nodeType);
+    if (m_nonBlockElements.contains(nodeTypeOf(p_parentNode)) && nodeTypeOf(p_parentNode) != nodeType) {
+        p_parentNode = p_rootNodes.value(nodeType, NoNode);
     }
-    node = new QTreeWidgetItem(p_parentNode, nodeType);
+    node = newNode(p_parentNode, nodeType);
 
     setNodeProperties(node, nodeType, convertTagContent(text), lineNumber, columnNumber);
 
     if (m_nonBlockElements.contains(nodeType)) {
-        node->setData(0, EndLine, lineNumber);
+        setNodeEndLine(node, lineNumber);
     }
 
     return true;
@@ -593,7 +672,7 @@ int XmlTypeParser::registerTag(const QString &tag, IconCollection::IconType icon
 {
     int nodeType = FirstNodeType + p_tagTypes.size();
     p_tagTypes.insert(tag.toLower(), TagType(nodeType, EndTag::Required));
-    p_nodeTypes.insert(nodeType, NodeTypeStruct(tag.toLower(), IconCollection::getIcon(iconType)));
+    p_tagIcons.append(qMakePair(nodeType, iconType));
 
     return nodeType;
 }
@@ -623,12 +702,14 @@ void XmlTypeParser::analyzeDocTypeTag()
 
 void XmlTypeParser::detectDocType(const QStringList &docType)
 {
+    p_docTypeHint = docType;
+
     // We need to "load the setup", ensure all is clean...
     p_tagTypes.clear();
+    p_tagIcons.clear();
     m_nodeTextSpecial.clear();
     m_attributeToUseForNodeText.clear();
-    // ..reset intern auto color counter so the colors are always the same between doc type changes
-    IconCollection::getIcon(-1);
+    // ..the intern auto color counter is reset in finishParse()
 
     if (   docType.contains(QStringLiteral("\"language.dtd\""), Qt::CaseInsensitive)
         || docType.contains(QStringLiteral("DTD"), Qt::CaseInsensitive)
@@ -111,10 +111,17 @@ protected:
     /**
      * @param tag The tag name as them occur in some document, e.g. h1 or section
      * @param iconType The icon type name defined by @c IconCollection::IconType
+     * @note The node type is not added to @c p_nodeTypes and the icon is not painted
+     * here, because we may run in the worker thread, that is done later by finishParse()
      * @return The number of the new added node type
      */
     int registerTag(const QString &tag, IconCollection::IconType iconType);
 
+    /**
+     * @return the tag of @p nodeType, when it was set by @c registerTag()
+     */
+    virtual QString nodeTypeName(int nodeType) const override;
+
     bool tagIsKnown() { return p_currentTag.nodeType != -1; };
     bool tagIsKnownEndTag() { return p_currentTagIsEndTagOfType != -1; };
     bool tagIsComment() { return p_currentTagIsComment; };
@@ -126,17 +133,17 @@ protected:
      * to deliver each tag on @c m_line in @c m_tag with removed angle brackets and the
      * content in @c m_tagContent. The content of @c m_tag is anything what looks like a tag independent
      * what some parser class knows or is looking for or was set by @c registerTag()
+     * Before the next tag is searched is Parser::passCheckpoint() called.
      * @return true when anything is found what looked like a tag, false when end of document is reached
      */
     bool nextTag();
 
 private:
     /**
-     * This helper function is called from parseDocument() and add FIXME/TODO and BEGIN nodes.
-     * @param rxType is used in a RegExp
-     * @param nodeType should fitting to rxType
+     * This helper function is called from parseDocument() and add FIXME/TODO, BEGIN
+     * and user tag nodes, as found by m_commentTags.
      */
-    bool addSpecialCommentNode(const QString &rxType, const int nodeType);
+    bool addSpecialCommentNode();
 
     /**
      * This helper function is called in nextTag() and take care not to lost partial found
@@ -165,6 +172,14 @@ private:
 protected:
     virtual void prepareForParse() override;
     virtual void parseDocument() override;
+    virtual void finishParse() override;
+
+    /**
+    * The nesting, the collected content and the doc type are added to the @p state.
+    * @see Parser::saveScanState()
+    */
+    virtual void saveScanState(ScanState &state) const override;
+    virtual void restoreScanState(ScanState &state) override;
 
 
     /**
@@ -209,7 +224,7 @@ protected:
      */
     QString convertTagContent(const QString &text);
 
-    int parentNodeType() { return p_parentNode ? p_parentNode->type() : -1; };
+    int parentNodeType() { return p_parentNode != NoNode ? nodeTypeOf(p_parentNode) : -1; };
     int nestingLevel() { return p_nestingStack.size(); };
 
     QSet<int>       m_nonBlockElements; // TODO guess can be removed, but is used in addNode()
@@ -295,17 +310,25 @@ private:
     QAction                          *p_detachComments;
 
     QString                           p_loadedDocType;
+    QStringList                       p_docTypeHint;   // As given to detectDocType(), to load it again
     int                               p_currCharIndex; // Indicate position on m_line where we parse
     QHash<QString, TagType>           p_tagTypes;
+    QList<QPair<int, IconCollection::IconType>> p_tagIcons; // Filled by registerTag(), added by finishParse()
     TagType                           p_currentTag; // Set by nextTag() and hold the result of p_tagTypes.value(m_tag)
     int                               p_currentTagIsEndTagOfType; // Set by nextTag() when current tag starts with / and hold the nodeType
     bool                              p_currentTagIsComment; // Set by nextTag() when current tag starts with !-- an end with --
     bool                              p_betterConvertTagContent; // Set by findNextAngle() and used in addNode()
     int                               p_nonWhiteSpaceRead; // Count in findNextAngle() and is compared to Max_View_Lenght
 
-    QTreeWidgetItem*                  p_parentNode;
-    QStack<QTreeWidgetItem*>          p_nestingStack;
+    int                               p_parentNode;
+    QStack<int>                       p_nestingStack;
     int                               p_nestingFoo; // FIXME Need better name. It's used to ignore nested content when parent is not wanted
+
+    // Tag content of our interest is often spiked with inline tags which we not even know
+    // and ignore. But we need to collect there content and use it for our known tags
+    QString                           p_contentCollector;
+    bool                              p_lastNodeNeedContent = false;
+    bool                              p_newContentIsAvailable = false;
 };
 
 #endif
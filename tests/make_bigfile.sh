@@ -0,0 +1,154 @@
+#!/usr/bin/env bash
+#
+# Write a C++ file of more than two chunks, see Chunk_MinSize in parser.h, to check
+# the parsing in parallel chunks with modules which only look alike
+#
+#   $ ../tests/make_bigfile.sh /tmp/testfile.cc
+#   $ ./index-view/indexview-cli --verify /tmp/testfile.cc
+#
+
+out=${1:?Usage: make_bigfile.sh <file.cc>}
+modules=${2:-200}
+
+{
+cat <<EOF
+/*   A big test file generated by make_bigfile.sh, run "indexview-cli --verify"
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+EOF
+
+for ((n = 0; n < modules; ++n)); do
+    m=$(printf '%03d' $n)
+    k=$((n % 6))
+    # Shape<T>:: when the class is a template
+    s="Shape$m"; t=""
+    if ((k == 2)); then s="Shape$m<T>"; t=$'template<typename T>\n'; fi
+
+    echo "// Module $m ------------------------------------------------------------"
+    if ((k == 0)); then
+        echo "/* A multi line comment, which has no function"
+        echo " * like foo$m() { return; }"
+        echo " */"
+    fi
+    echo "#define MODULE_${m}_SIZE $((n + 1))"
+    if ((k == 1)); then
+        echo "#define MODULE_${m}_MAX(a, b) \\"
+        echo "    ((a) > (b) ? (a) : (b))"
+    fi
+
+cat <<EOF
+
+namespace module$m {
+
+enum class State$m {
+    Idle,
+    Busy,
+    Done
+};
+
+struct Point$m {
+    int x = 0;
+    int y = 0;
+};
+
+${t}class Shape$m : public Base
+{
+public:
+    Shape$m();
+    ~Shape$m() override;
+
+    int area() const;
+    std::string name() const { return "shape {$m}"; }
+
+protected:
+    void update(int value,
+                const Point$m &where);
+
+private:
+    int p_value = 0;
+    std::vector<Point$m> p_points;
+};
+
+
+${t}$s::Shape$m()
+    : Base()
+{
+}
+
+
+${t}$s::~Shape$m()
+{
+}
+
+
+${t}int $s::area() const
+{
+    int sum = 0;
+    for (const Point$m &p : p_points) {
+        sum += p.x * p.y;
+    }
+
+    return sum;
+}
+
+
+${t}void $s::update(int value,
+                       const Point$m &where)
+{
+    if (value < 0) {
+        std::printf("negative value '%d' at {%d, %d}\\n", value, where.x, where.y);
+        return;
+    }
+
+    p_value = value;
+    p_points.push_back(where);
+}
+
+
+static int countBraces$m(const char *text)
+{
+EOF
+    if ((k == 3)); then
+        echo "    // TODO Count also braces which are escaped, like \\{ and \\}"
+    fi
+cat <<EOF
+    int count = 0; // A '{' or '}' in a comment doesn't count
+    for (const char *c = text; *c; ++c) {
+        if (*c == '{' || *c == '}') {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+EOF
+    if ((k == 4)); then
+        echo
+        echo "static const char *s_help$m = \"Usage: tool [options] {\""
+        echo "                             \"  --verbose }\";"
+        echo
+    fi
+    if ((k == 5)); then
+        echo
+        echo "int unusedFunction$m(int a, int b); // Only a declaration"
+        echo
+    fi
+    echo "} // namespace module$m"
+    echo
+    echo
+done
+
+cat <<EOF
+int main()
+{
+    return 0;
+}
+EOF
+} > "$out"
+
+# kate: space-indent on; indent-width 4; replace-tabs on;
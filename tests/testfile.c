@@ -193,4 +193,35 @@ B\
 C = 5;
 }
 
+// Each 512 lines is a checkpoint saved, so that a later run can resume from there.
+// The open comment must survive it, "indexview-cli --verify" repeat this file so
+// that some checkpoints are in here
+int beforeComments; /* Each of these lines close a comment, add a variable
+*/ int inComments00; /* and open a new comment
+*/ int inComments01; /* and open a new comment
+*/ int inComments02; /* and open a new comment
+*/ int inComments03; /* and open a new comment
+*/ int inComments04; /* and open a new comment
+*/ int inComments05; /* and open a new comment
+*/ int inComments06; /* and open a new comment
+*/ int inComments07; /* and open a new comment
+*/ int inComments08; /* and open a new comment
+*/ int inComments09; /* and open a new comment
+*/ int inComments10; /* and open a new comment
+*/ int inComments11; /* and open a new comment
+*/ int inComments12; /* and open a new comment
+*/ int inComments13; /* and open a new comment
+*/ int inComments14; /* and open a new comment
+*/ int inComments15; /* and open a new comment
+*/ int inComments16; /* and open a new comment
+*/ int inComments17; /* and open a new comment
+*/ int inComments18; /* and open a new comment
+*/ int inComments19; /* and open a new comment
+   which run over some lines
+int notAVariable;
+*/
+int afterComments() {
+    return 0;
+}
+
 // kate: space-indent on; indent-width 4; replace-tabs on;
@@ -77,3 +77,23 @@ func getDownloadReader(f *RequestedFile) (time.Time, io.ReadSeekCloser, error) {
 
 	return time.Time{}, nil, d.eventError
 }
+
+// Back quoted raw strings may contain anything, also across lines
+var usage = `Usage: indexview [options] {
+	"quotes", 'single' // and no comment /* neither this
+}`
+
+func rawStrings() string {
+	return `{` + "}" + `*/` + `\`
+}
+
+func isBackQuote(r rune) bool {
+	return r == '`'
+}
+
+/* A multi line comment
+func notAFunction() {
+}
+*/
+func afterComment() {
+}